@@ -0,0 +1,78 @@
+/*
+ * GCTA: a tool for Genome-wide Complex Trait Analysis
+ *
+ * Implementations of the memory-mapped PLINK BED file reader
+ *
+ * This file is distributed under the GNU General Public
+ * License, Version 2.  Please see the file COPYING for more
+ * details
+ */
+
+#include "BedFile.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+BedFile::BedFile()
+{
+    _data=NULL;
+    _size=0;
+    _indi_num=_byte_num=0;
+}
+
+BedFile::~BedFile()
+{
+    close();
+}
+
+void BedFile::close()
+{
+    if(_data!=NULL) munmap((void *)_data, _size);
+    _data=NULL;
+    _size=0;
+}
+
+void BedFile::open(string bedfile, int snp_num, int indi_num)
+{
+    close();
+    int fd=::open(bedfile.c_str(), O_RDONLY);
+    if(fd<0) throw("Error: can not open the file ["+bedfile+"] to read.");
+    struct stat st;
+    if(fstat(fd, &st)!=0){
+        ::close(fd);
+        throw("Error: can not open the file ["+bedfile+"] to read.");
+    }
+    _indi_num=indi_num;
+    _byte_num=(indi_num+3)/4;
+    _size=st.st_size;
+    if(_size<3+(unsigned long)snp_num*_byte_num){
+        ::close(fd);
+        throw("Error: problem with the BED file ... has the FAM/BIM file been changed?");
+    }
+    void *buf=mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(buf==MAP_FAILED){
+        _size=0;
+        throw("Error: can not map the file ["+bedfile+"] into memory.");
+    }
+    _data=(const unsigned char *)buf;
+    if(_data[0]!=0x6c || _data[1]!=0x1b || _data[2]!=0x01){
+        close();
+        throw("Error: ["+bedfile+"] is not a PLINK BED file in SNP-major format.");
+    }
+}
+
+void BedFile::prefetch(int j_start, int j_end)
+{
+    if(_data==NULL || j_end<j_start) return;
+    unsigned long page=sysconf(_SC_PAGESIZE);
+    unsigned long start=snp_ptr(j_start)-_data, end=snp_ptr(j_end)-_data+_byte_num;
+    start-=start%page;
+    madvise((void *)(_data+start), end-start, MADV_WILLNEED);
+}
+
+void BedFile::advise(bool sparse)
+{
+    if(_data!=NULL) madvise((void *)_data, _size, sparse?MADV_RANDOM:MADV_SEQUENTIAL);
+}
@@ -0,0 +1,51 @@
+/*
+ * GCTA: a tool for Genome-wide Complex Trait Analysis
+ *
+ * Interface to the memory-mapped PLINK BED file reader
+ *
+ * The SNP-major BED file is mapped read-only; the record of SNP j starts at
+ * byte 3+j*ceil(n/4) so excluded SNPs are never touched, and the packed
+ * bytes are handed out in place without copying.
+ *
+ * This file is distributed under the GNU General Public
+ * License, Version 2.  Please see the file COPYING for more
+ * details
+ */
+
+#ifndef _BEDFILE_H
+#define _BEDFILE_H
+
+#include <string>
+using namespace std;
+
+class BedFile
+{
+public:
+    BedFile();
+    ~BedFile();
+
+    void open(string bedfile, int snp_num, int indi_num);
+    void close();
+
+    // hint the kernel on the access pattern, random if only a small fraction of the SNPs is read
+    void advise(bool sparse);
+
+    // start reading the records of SNPs j_start to j_end in the background
+    void prefetch(int j_start, int j_end);
+
+    bool is_open() const {return _data!=NULL;}
+    int indi_num() const {return _indi_num;}
+    int byte_num() const {return _byte_num;}
+    const unsigned char *snp_ptr(int j) const {return _data+3+(unsigned long)j*_byte_num;}
+
+private:
+    BedFile(const BedFile &);
+    BedFile &operator=(const BedFile &);
+
+    const unsigned char *_data;
+    unsigned long _size;
+    int _indi_num;
+    int _byte_num;
+};
+
+#endif
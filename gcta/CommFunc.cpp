@@ -9,6 +9,7 @@
  */
 
 #include "CommFunc.h"
+#include <cstdio>
 
 double CommFunc::Abs(const double &x)
 {
@@ -123,4 +124,9 @@ void CommFunc::FileExist(string filename)
 {
     ifstream ifile(filename.c_str());
     if(!ifile) throw("Error: can not open the file ["+filename+"] to read.");
-}
\ No newline at end of file
+}
+
+void CommFunc::FileRename(string tmp_file, string filename)
+{
+    if(rename(tmp_file.c_str(), filename.c_str())!=0) throw("Error: can not rename the file ["+tmp_file+"] to ["+filename+"].");
+}
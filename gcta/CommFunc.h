@@ -36,6 +36,7 @@ namespace CommFunc
 	const double Sign(const double &a, const double &b);
 	int rand_seed(); //positive value, return random seed using the system time
     void FileExist(string filename);
+    void FileRename(string tmp_file, string filename); // replaces filename by tmp_file
 }
 
 #endif
@@ -0,0 +1,340 @@
+/*
+ * GCTA: a tool for Genome-wide Complex Trait Analysis
+ *
+ * Implementations of the decoders of packed 2-bit genotypes
+ *
+ * This file is distributed under the GNU General Public
+ * License, Version 2.  Please see the file COPYING for more
+ * details
+ */
+
+#include "GenoDecode.h"
+#include <cstring>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GENO_CPU_DISPATCH
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // the four codes of each byte value, lowest genotype in the first byte
+    struct CodeTable
+    {
+        uint32_t code[256];
+        CodeTable()
+        {
+            int b=0, k=0;
+            for(b=0; b<256; b++){
+                code[b]=0;
+                for(k=0; k<4; k++) code[b]|=(uint32_t)((b>>(k<<1))&3)<<(k<<3);
+            }
+        }
+    };
+    const CodeTable table;
+
+#if defined(GENO_CPU_DISPATCH)
+    // instruction sets of the host CPU, checked once so that the kernels below are chosen at run time
+    struct CpuFeature
+    {
+        bool avx2, popcnt, avx512_popcnt;
+        CpuFeature()
+        {
+            __builtin_cpu_init();
+            avx2=__builtin_cpu_supports("avx2");
+            popcnt=__builtin_cpu_supports("popcnt");
+            avx512_popcnt=__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq");
+        }
+    };
+    const CpuFeature cpu;
+#endif
+
+    inline int popcount(uint64_t w)
+    {
+#if defined(__GNUC__)
+        return __builtin_popcountll(w);
+#else
+        w=w-((w>>1) & 0x5555555555555555ULL);
+        w=(w & 0x3333333333333333ULL)+((w>>2) & 0x3333333333333333ULL);
+        w=(w+(w>>4)) & 0x0f0f0f0f0f0f0f0fULL;
+        return (int)((w*0x0101010101010101ULL)>>56);
+#endif
+    }
+
+    // table-driven decoders from genotype i on (i a multiple of 4), shared by all the kernels
+    inline void code_lut(const unsigned char *packed, int i, int n, unsigned char *code)
+    {
+        int b=i>>2;
+        for(; i+4<=n; i+=4, b++) memcpy(code+i, &table.code[packed[b]], 4);
+        for(; i<n; i++) code[i]=(packed[i>>2]>>((i&3)<<1))&3;
+    }
+
+    template<class T>
+    inline void value_lut(const unsigned char *packed, int i, int n, const T val[4], T *x)
+    {
+        int k=0, b=i>>2;
+        for(; i+4<=n; i+=4, b++){
+            const unsigned char *c=(const unsigned char *)&table.code[packed[b]];
+            for(k=0; k<4; k++) x[i+k]=val[c[k]];
+        }
+        for(; i<n; i++) x[i]=val[(packed[i>>2]>>((i&3)<<1))&3];
+    }
+
+    inline void add_value_lut(const unsigned char *packed, int i, int n, const double val[4], double *x)
+    {
+        int k=0, b=i>>2;
+        for(; i+4<=n; i+=4, b++){
+            const unsigned char *c=(const unsigned char *)&table.code[packed[b]];
+            for(k=0; k<4; k++) x[i+k]+=val[c[k]];
+        }
+        for(; i<n; i++) x[i]+=val[(packed[i>>2]>>((i&3)<<1))&3];
+    }
+
+    // popcount loops from word i on, compiled again with a hardware popcount below
+    inline int miss_count_loop(const uint64_t *w, int i, int n_word)
+    {
+        int count=0;
+        for(; i<n_word; i++) count+=popcount(GenoDecode::miss_mask(w[i]));
+        return count;
+    }
+
+    inline int and_count_loop(const uint64_t *a, const uint64_t *b, int i, int n_word)
+    {
+        int count=0;
+        for(; i+4<=n_word; i+=4){
+            count+=popcount(a[i] & b[i])+popcount(a[i+1] & b[i+1]);
+            count+=popcount(a[i+2] & b[i+2])+popcount(a[i+3] & b[i+3]);
+        }
+        for(; i<n_word; i++) count+=popcount(a[i] & b[i]);
+        return count;
+    }
+
+    inline int dose_product_loop(const uint64_t *a, const uint64_t *b, int i, int n_word, int &both)
+    {
+        int c11=0, c12=0, c22=0;
+        const uint64_t *a1=a, *a2=a+n_word, *an=a+2*n_word, *b1=b, *b2=b+n_word, *bn=b+2*n_word;
+        for(; i<n_word; i++){
+            c11+=popcount(a1[i] & b1[i]);
+            c12+=popcount(a1[i] & b2[i])+popcount(a2[i] & b1[i]);
+            c22+=popcount(a2[i] & b2[i]);
+            both+=popcount(an[i] & bn[i]);
+        }
+        return c11+2*c12+4*c22;
+    }
+
+#if defined(GENO_CPU_DISPATCH)
+    __attribute__((target("avx2"))) void code_avx2(const unsigned char *packed, int n, unsigned char *code)
+    {
+        int i=0, b=0;
+        const __m256i mask=_mm256_set1_epi8(3);
+        for(; i+128<=n; i+=128, b+=32){
+            __m256i x=_mm256_loadu_si256((const __m256i *)(packed+b));
+            __m256i v0=_mm256_and_si256(x, mask);
+            __m256i v1=_mm256_and_si256(_mm256_srli_epi16(x, 2), mask);
+            __m256i v2=_mm256_and_si256(_mm256_srli_epi16(x, 4), mask);
+            __m256i v3=_mm256_and_si256(_mm256_srli_epi16(x, 6), mask);
+            __m256i a=_mm256_unpacklo_epi8(v0, v1), c=_mm256_unpacklo_epi8(v2, v3);
+            __m256i o0=_mm256_unpacklo_epi16(a, c), o1=_mm256_unpackhi_epi16(a, c);
+            a=_mm256_unpackhi_epi8(v0, v1);
+            c=_mm256_unpackhi_epi8(v2, v3);
+            __m256i o2=_mm256_unpacklo_epi16(a, c), o3=_mm256_unpackhi_epi16(a, c);
+            _mm256_storeu_si256((__m256i *)(code+i), _mm256_permute2x128_si256(o0, o1, 0x20));
+            _mm256_storeu_si256((__m256i *)(code+i+32), _mm256_permute2x128_si256(o2, o3, 0x20));
+            _mm256_storeu_si256((__m256i *)(code+i+64), _mm256_permute2x128_si256(o0, o1, 0x31));
+            _mm256_storeu_si256((__m256i *)(code+i+96), _mm256_permute2x128_si256(o2, o3, 0x31));
+        }
+        code_lut(packed, i, n, code);
+    }
+
+    __attribute__((target("avx2"))) void value_avx2(const unsigned char *packed, int n, const float val[4], float *x)
+    {
+        int i=0, b=0;
+        const __m256 vtab=_mm256_setr_ps(val[0], val[1], val[2], val[3], val[0], val[1], val[2], val[3]);
+        const __m256i shift=_mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+        const __m256i mask=_mm256_set1_epi32(3);
+        for(; i+8<=n; i+=8, b+=2){
+            uint32_t w=packed[b] | ((uint32_t)packed[b+1]<<8);
+            __m256i c=_mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(w), shift), mask);
+            _mm256_storeu_ps(x+i, _mm256_permutevar8x32_ps(vtab, c));
+        }
+        value_lut(packed, i, n, val, x);
+    }
+
+    __attribute__((target("avx2"))) void value_avx2(const unsigned char *packed, int n, const double val[4], double *x)
+    {
+        int i=0, b=0;
+        const __m256d vlo=_mm256_setr_pd(val[0], val[1], val[0], val[1]), vhi=_mm256_setr_pd(val[2], val[3], val[2], val[3]);
+        const __m256i shift=_mm256_setr_epi64x(0, 2, 4, 6);
+        const __m256i mask=_mm256_set1_epi64x(3);
+        for(; i+4<=n; i+=4, b++){
+            __m256i c=_mm256_and_si256(_mm256_srlv_epi64(_mm256_set1_epi64x(packed[b]), shift), mask);
+            // bit 1 of the code selects the table half, bit 0 the element within it
+            __m256i sel=_mm256_slli_epi64(c, 1);
+            __m256d lo=_mm256_permutevar_pd(vlo, sel), hi=_mm256_permutevar_pd(vhi, sel);
+            _mm256_storeu_pd(x+i, _mm256_blendv_pd(lo, hi, _mm256_castsi256_pd(_mm256_slli_epi64(c, 62))));
+        }
+        value_lut(packed, i, n, val, x);
+    }
+
+    __attribute__((target("avx2"))) void add_value_avx2(const unsigned char *packed, int n, const double val[4], double *x)
+    {
+        int i=0, b=0;
+        const __m256d vlo=_mm256_setr_pd(val[0], val[1], val[0], val[1]), vhi=_mm256_setr_pd(val[2], val[3], val[2], val[3]);
+        const __m256i shift=_mm256_setr_epi64x(0, 2, 4, 6);
+        const __m256i mask=_mm256_set1_epi64x(3);
+        for(; i+4<=n; i+=4, b++){
+            __m256i c=_mm256_and_si256(_mm256_srlv_epi64(_mm256_set1_epi64x(packed[b]), shift), mask);
+            __m256i sel=_mm256_slli_epi64(c, 1);
+            __m256d lo=_mm256_permutevar_pd(vlo, sel), hi=_mm256_permutevar_pd(vhi, sel);
+            __m256d y=_mm256_blendv_pd(lo, hi, _mm256_castsi256_pd(_mm256_slli_epi64(c, 62)));
+            _mm256_storeu_pd(x+i, _mm256_add_pd(_mm256_loadu_pd(x+i), y));
+        }
+        add_value_lut(packed, i, n, val, x);
+    }
+
+    __attribute__((target("popcnt"))) int miss_count_popcnt(const uint64_t *w, int n_word)
+    {
+        return miss_count_loop(w, 0, n_word);
+    }
+
+    __attribute__((target("popcnt"))) int and_count_popcnt(const uint64_t *a, const uint64_t *b, int n_word)
+    {
+        return and_count_loop(a, b, 0, n_word);
+    }
+
+    __attribute__((target("popcnt"))) int dose_product_popcnt(const uint64_t *a, const uint64_t *b, int n_word, int &both)
+    {
+        both=0;
+        return dose_product_loop(a, b, 0, n_word, both);
+    }
+
+    __attribute__((target("popcnt,avx512f,avx512vpopcntdq"))) int and_count_avx512(const uint64_t *a, const uint64_t *b, int n_word)
+    {
+        int i=0;
+        __m512i sum=_mm512_setzero_si512();
+        for(; i+8<=n_word; i+=8){
+            __m512i w=_mm512_and_si512(_mm512_loadu_si512((const void *)(a+i)), _mm512_loadu_si512((const void *)(b+i)));
+            sum=_mm512_add_epi64(sum, _mm512_popcnt_epi64(w));
+        }
+        return (int)_mm512_reduce_add_epi64(sum)+and_count_loop(a, b, i, n_word);
+    }
+
+    __attribute__((target("popcnt,avx512f,avx512vpopcntdq"))) int dose_product_avx512(const uint64_t *a, const uint64_t *b, int n_word, int &both)
+    {
+        int i=0, c=0;
+        const uint64_t *a1=a, *a2=a+n_word, *an=a+2*n_word, *b1=b, *b2=b+n_word, *bn=b+2*n_word;
+        __m512i s11=_mm512_setzero_si512(), s12=_mm512_setzero_si512(), s22=_mm512_setzero_si512(), snn=_mm512_setzero_si512();
+        for(; i+8<=n_word; i+=8){
+            __m512i x1=_mm512_loadu_si512((const void *)(a1+i)), x2=_mm512_loadu_si512((const void *)(a2+i));
+            __m512i y1=_mm512_loadu_si512((const void *)(b1+i)), y2=_mm512_loadu_si512((const void *)(b2+i));
+            s11=_mm512_add_epi64(s11, _mm512_popcnt_epi64(_mm512_and_si512(x1, y1)));
+            s12=_mm512_add_epi64(s12, _mm512_popcnt_epi64(_mm512_and_si512(x1, y2)));
+            s12=_mm512_add_epi64(s12, _mm512_popcnt_epi64(_mm512_and_si512(x2, y1)));
+            s22=_mm512_add_epi64(s22, _mm512_popcnt_epi64(_mm512_and_si512(x2, y2)));
+            snn=_mm512_add_epi64(snn, _mm512_popcnt_epi64(_mm512_and_si512(_mm512_loadu_si512((const void *)(an+i)), _mm512_loadu_si512((const void *)(bn+i)))));
+        }
+        c=(int)_mm512_reduce_add_epi64(s11)+2*(int)_mm512_reduce_add_epi64(s12)+4*(int)_mm512_reduce_add_epi64(s22);
+        both=(int)_mm512_reduce_add_epi64(snn);
+        return c+dose_product_loop(a, b, i, n_word, both);
+    }
+#endif
+}
+
+void GenoDecode::code(const unsigned char *packed, int n, unsigned char *code)
+{
+#if defined(GENO_CPU_DISPATCH)
+    if(cpu.avx2){
+        code_avx2(packed, n, code);
+        return;
+    }
+#endif
+    int i=0, b=0;
+#if defined(__SSE2__)
+    const __m128i mask=_mm_set1_epi8(3);
+    for(; i+64<=n; i+=64, b+=16){
+        __m128i x=_mm_loadu_si128((const __m128i *)(packed+b));
+        __m128i v0=_mm_and_si128(x, mask);
+        __m128i v1=_mm_and_si128(_mm_srli_epi16(x, 2), mask);
+        __m128i v2=_mm_and_si128(_mm_srli_epi16(x, 4), mask);
+        __m128i v3=_mm_and_si128(_mm_srli_epi16(x, 6), mask);
+        __m128i a=_mm_unpacklo_epi8(v0, v1), c=_mm_unpacklo_epi8(v2, v3);
+        _mm_storeu_si128((__m128i *)(code+i), _mm_unpacklo_epi16(a, c));
+        _mm_storeu_si128((__m128i *)(code+i+16), _mm_unpackhi_epi16(a, c));
+        a=_mm_unpackhi_epi8(v0, v1);
+        c=_mm_unpackhi_epi8(v2, v3);
+        _mm_storeu_si128((__m128i *)(code+i+32), _mm_unpacklo_epi16(a, c));
+        _mm_storeu_si128((__m128i *)(code+i+48), _mm_unpackhi_epi16(a, c));
+    }
+#endif
+    code_lut(packed, i, n, code);
+}
+
+void GenoDecode::value(const unsigned char *packed, int n, const float val[4], float *x)
+{
+#if defined(GENO_CPU_DISPATCH)
+    if(cpu.avx2){
+        value_avx2(packed, n, val, x);
+        return;
+    }
+#endif
+    value_lut(packed, 0, n, val, x);
+}
+
+void GenoDecode::value(const unsigned char *packed, int n, const double val[4], double *x)
+{
+#if defined(GENO_CPU_DISPATCH)
+    if(cpu.avx2){
+        value_avx2(packed, n, val, x);
+        return;
+    }
+#endif
+    value_lut(packed, 0, n, val, x);
+}
+
+void GenoDecode::add_value(const unsigned char *packed, int n, const double val[4], double *x)
+{
+#if defined(GENO_CPU_DISPATCH)
+    if(cpu.avx2){
+        add_value_avx2(packed, n, val, x);
+        return;
+    }
+#endif
+    add_value_lut(packed, 0, n, val, x);
+}
+
+int GenoDecode::miss_count(const uint64_t *w, int n_word)
+{
+#if defined(GENO_CPU_DISPATCH)
+    if(cpu.popcnt) return miss_count_popcnt(w, n_word);
+#endif
+    return miss_count_loop(w, 0, n_word);
+}
+
+int GenoDecode::and_count(const uint64_t *a, const uint64_t *b, int n_word)
+{
+#if defined(GENO_CPU_DISPATCH)
+    if(cpu.avx512_popcnt) return and_count_avx512(a, b, n_word);
+    if(cpu.popcnt) return and_count_popcnt(a, b, n_word);
+#endif
+    return and_count_loop(a, b, 0, n_word);
+}
+
+int GenoDecode::dose_product(const uint64_t *a, const uint64_t *b, int n_word, int &both)
+{
+#if defined(GENO_CPU_DISPATCH)
+    if(cpu.avx512_popcnt) return dose_product_avx512(a, b, n_word, both);
+    if(cpu.popcnt) return dose_product_popcnt(a, b, n_word, both);
+#endif
+    both=0;
+    return dose_product_loop(a, b, 0, n_word, both);
+}
+
+bool GenoDecode::fast_popcount()
+{
+#if defined(GENO_CPU_DISPATCH)
+    return cpu.popcnt;
+#else
+    return false;
+#endif
+}
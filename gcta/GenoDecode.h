@@ -0,0 +1,51 @@
+/*
+ * GCTA: a tool for Genome-wide Complex Trait Analysis
+ *
+ * Interface to the decoders of packed 2-bit genotypes
+ *
+ * Packed genotypes are in the PLINK BED layout, four per byte with the
+ * first individual in the two lowest bits. The expansion kernels are
+ * table driven, with SSE2/AVX2 versions. The AVX2, POPCNT and AVX-512
+ * kernels are chosen at run time for the host CPU, so that the default
+ * build uses them.
+ *
+ * This file is distributed under the GNU General Public
+ * License, Version 2.  Please see the file COPYING for more
+ * details
+ */
+
+#ifndef _GENODECODE_H
+#define _GENODECODE_H
+
+#include <stdint.h>
+
+namespace GenoDecode
+{
+    // one genotype code (0-3) per byte
+    void code(const unsigned char *packed, int n, unsigned char *code);
+
+    // val[c] for each genotype with code c
+    void value(const unsigned char *packed, int n, const float val[4], float *x);
+    void value(const unsigned char *packed, int n, const double val[4], double *x);
+
+    // x[i]+=val[c] for each genotype with code c
+    void add_value(const unsigned char *packed, int n, const double val[4], double *x);
+
+    // the low bit of each 2-bit field is set if the genotype is missing (code 01)
+    inline uint64_t miss_mask(uint64_t w) {return w & ~(w>>1) & 0x5555555555555555ULL;}
+
+    // number of missing genotypes in n_word words
+    int miss_count(const uint64_t *w, int n_word);
+
+    // number of bits set in both a and b
+    int and_count(const uint64_t *a, const uint64_t *b, int n_word);
+
+    // a and b each hold three bit planes of n_word words: dosage 1, dosage 2 and non-missing;
+    // returns the sum of the products of the dosages, with the number of SNPs non-missing in both in both
+    int dose_product(const uint64_t *a, const uint64_t *b, int n_word, int &both);
+
+    // true if the host CPU has a popcount instruction
+    bool fast_popcount();
+}
+
+#endif
@@ -0,0 +1,134 @@
+/*
+ * GCTA: a tool for Genome-wide Complex Trait Analysis
+ *
+ * Implementations of the bit-packed genotype store
+ *
+ * This file is distributed under the GNU General Public
+ * License, Version 2.  Please see the file COPYING for more
+ * details
+ */
+
+#include "GenoStore.h"
+#include "GenoDecode.h"
+#include <cstdlib>
+#include <cstring>
+
+GenoStore::GenoStore()
+{
+    _geno=NULL;
+    _capacity=0;
+    _snp_start=_snp_num=_indi_num=_word_num=0;
+}
+
+GenoStore::~GenoStore()
+{
+    clear();
+}
+
+void GenoStore::clear()
+{
+    if(_geno!=NULL) free(_geno);
+    _geno=NULL;
+    _capacity=0;
+    _snp_start=_snp_num=_indi_num=_word_num=0;
+}
+
+void GenoStore::init(int snp_num, int indi_num, int snp_start)
+{
+    unsigned long i=0, size=0;
+    if(snp_num<1 || indi_num<1){
+        clear();
+        return;
+    }
+
+    // the buffer is reused when it is large enough, e.g. when loading consecutive windows of SNPs
+    size=(unsigned long)snp_num*((indi_num+31)/32);
+    if(size>_capacity){
+        clear();
+        void *buf=NULL;
+        if(posix_memalign(&buf, 64, size*sizeof(uint64_t))!=0) throw("Error: insufficient memory to store the genotype data.");
+        _geno=(uint64_t *)buf;
+        _capacity=size;
+    }
+    _snp_start=snp_start;
+    _snp_num=snp_num;
+    _indi_num=indi_num;
+    _word_num=(indi_num+31)/32;
+    #pragma omp parallel for
+    for(i=0; i<size; i++) _geno[i]=MISS_WORD;
+}
+
+void GenoStore::set(int j, int i, int code)
+{
+    uint64_t *w=snp_ptr(j)+(i>>5);
+    int shift=(i&31)<<1;
+    *w=(*w & ~(3ULL<<shift)) | ((uint64_t)(code&3)<<shift);
+}
+
+void GenoStore::get_snp(int j, const vector<int> &keep, unsigned char *code) const
+{
+    int i=0, k=0, w_indx=-1;
+    unsigned long n=keep.size();
+    uint64_t w=0;
+    const uint64_t *p=snp_ptr(j);
+    if(n==_indi_num){
+        GenoDecode::code((const unsigned char *)p, n, code);
+        return;
+    }
+    for(i=0; i<n; i++){
+        k=keep[i];
+        if((k>>5)!=w_indx){
+            w_indx=k>>5;
+            w=p[w_indx];
+        }
+        code[i]=(unsigned char)((w>>((k&31)<<1))&3);
+    }
+}
+
+void GenoStore::get_snp(int j, const vector<int> &keep, const float val[4], float *x) const
+{
+    int i=0;
+    unsigned long n=keep.size();
+    if(n==_indi_num){
+        GenoDecode::value((const unsigned char *)snp_ptr(j), n, val, x);
+        return;
+    }
+    for(i=0; i<n; i++) x[i]=val[get(j, keep[i])];
+}
+
+void GenoStore::get_snp(int j, const vector<int> &keep, const double val[4], double *x) const
+{
+    int i=0;
+    unsigned long n=keep.size();
+    if(n==_indi_num){
+        GenoDecode::value((const unsigned char *)snp_ptr(j), n, val, x);
+        return;
+    }
+    for(i=0; i<n; i++) x[i]=val[get(j, keep[i])];
+}
+
+void GenoStore::read_bed_snp(int j, const unsigned char *bed, int bed_indi_num, const vector<int> &kp)
+{
+    int i=0, k=0, t=0;
+    uint64_t w=0;
+    uint64_t *p=snp_ptr(j);
+
+    if(kp.empty()){
+        memcpy(p, bed, (bed_indi_num+3)/4);
+        // code the padding genotypes as missing
+        t=(_indi_num&31)<<1;
+        if(t>0) p[_word_num-1]=(p[_word_num-1] & ((1ULL<<t)-1)) | (MISS_WORD & ~((1ULL<<t)-1));
+        return;
+    }
+
+    for(i=0, w=0; i<kp.size(); i++){
+        k=kp[i];
+        w|=(uint64_t)((bed[k>>2]>>((k&3)<<1))&3)<<((i&31)<<1);
+        if((i&31)==31){
+            p[i>>5]=w;
+            w=0;
+        }
+    }
+    t=(i&31)<<1;
+    if(t>0) p[i>>5]=w | (MISS_WORD & ~((1ULL<<t)-1));
+}
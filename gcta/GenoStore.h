@@ -0,0 +1,74 @@
+/*
+ * GCTA: a tool for Genome-wide Complex Trait Analysis
+ *
+ * Interface to the bit-packed genotype store
+ *
+ * Genotypes are kept SNP-major in the 2-bit PLINK BED coding
+ * (00: homozygote A1; 01: missing; 10: heterozygote; 11: homozygote A2),
+ * 32 genotypes per 64-bit word. Each SNP starts on a word boundary and the
+ * unused genotypes at the end of a SNP are coded as missing. The store may
+ * hold a window of SNPs snp_start to snp_start+snp_num-1 only, in which case
+ * SNPs are still addressed by their overall index.
+ *
+ * This file is distributed under the GNU General Public
+ * License, Version 2.  Please see the file COPYING for more
+ * details
+ */
+
+#ifndef _GENOSTORE_H
+#define _GENOSTORE_H
+
+#include <stdint.h>
+#include <vector>
+using namespace std;
+
+class GenoStore
+{
+public:
+    GenoStore();
+    ~GenoStore();
+
+    void init(int snp_num, int indi_num, int snp_start=0); // all genotypes are set to missing
+    void clear();
+
+    int snp_start() const {return _snp_start;}
+    int snp_num() const {return _snp_num;}
+    int indi_num() const {return _indi_num;}
+    int word_num() const {return _word_num;}
+
+    uint64_t *snp_ptr(int j) {return _geno+(unsigned long)(j-_snp_start)*_word_num;}
+    const uint64_t *snp_ptr(int j) const {return _geno+(unsigned long)(j-_snp_start)*_word_num;}
+
+    // genotype code of individual i at SNP j
+    int get(int j, int i) const {return (int)((snp_ptr(j)[i>>5]>>((i&31)<<1))&3);}
+    void set(int j, int i, int code);
+
+    // codes of SNP j for the individuals in keep (sorted, as gcta::_keep), unpacked one word at a time
+    void get_snp(int j, const vector<int> &keep, unsigned char *code) const;
+
+    // val[c] for each genotype code c of SNP j for the individuals in keep
+    void get_snp(int j, const vector<int> &keep, const float val[4], float *x) const;
+    void get_snp(int j, const vector<int> &keep, const double val[4], double *x) const;
+
+    // store one SNP from a BED record of bed_indi_num individuals, keeping those in kp (all if kp is empty)
+    void read_bed_snp(int j, const unsigned char *bed, int bed_indi_num, const vector<int> &kp);
+
+    // number of A1 alleles carried; not defined for missing genotypes
+    static int dose(int code) {return 2-(code>>1)-(code&1);}
+    static bool miss(int code) {return code==1;}
+
+    static const uint64_t MISS_WORD=0x5555555555555555ULL;
+
+private:
+    GenoStore(const GenoStore &);
+    GenoStore &operator=(const GenoStore &);
+
+    uint64_t *_geno;
+    unsigned long _capacity;
+    int _snp_start;
+    int _snp_num;
+    int _indi_num;
+    int _word_num;
+};
+
+#endif
@@ -0,0 +1,283 @@
+/*
+ * GCTA: a tool for Genome-wide Complex Trait Analysis
+ *
+ * Implementations of the chunked, compressed GRM file (.grm.cbin)
+ *
+ * This file is distributed under the GNU General Public
+ * License, Version 2.  Please see the file COPYING for more
+ * details
+ */
+
+#include "GrmCbin.h"
+#include <stdint.h>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <zlib.h>
+#include <omp.h>
+
+namespace GrmCbin
+{
+    const char MAGIC[8]={'G','C','T','A','G','R','M','2'};
+    const uint32_t VERSION=1;
+    const unsigned long CHUNK_SIZE=1UL<<20; // elements
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t type;
+        uint64_t n;
+        uint64_t chunk_num;
+    };
+
+    struct Chunk
+    {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t crc;
+    };
+
+    int elem_size(int type) {return type==F32?4:2;}
+
+    uint16_t float_to_half(float f)
+    {
+        uint32_t x=0, m=0, h=0, rem=0, half=0, sign=0;
+        int e=0, shift=0;
+        memcpy(&x, &f, 4);
+        sign=(x>>16)&0x8000;
+        m=x&0x7fffff;
+        if(((x>>23)&0xff)==0xff) return sign|0x7c00|(m?0x200:0);
+        e=(int)((x>>23)&0xff)-112;
+        if(e>=31) return sign|0x7c00;
+        if(e<=0){
+            // subnormal
+            if(e<-10) return sign;
+            m|=0x800000;
+            shift=14-e;
+            h=m>>shift;
+            rem=m&((1u<<shift)-1);
+            half=1u<<(shift-1);
+            if(rem>half || (rem==half && (h&1))) h++;
+            return sign|h;
+        }
+        // round to nearest even, a carry into the exponent is correct
+        h=((uint32_t)e<<10)|(m>>13);
+        rem=m&0x1fff;
+        if(rem>0x1000 || (rem==0x1000 && (h&1))) h++;
+        return sign|h;
+    }
+
+    float half_to_float(uint16_t h)
+    {
+        uint32_t sign=(uint32_t)(h&0x8000)<<16, m=h&0x3ff, x=0;
+        int e=(h>>10)&0x1f;
+        float f=0.0;
+        if(e==0){
+            if(m==0) x=sign;
+            else{
+                e=1;
+                while(!(m&0x400)){ m<<=1; e--; }
+                x=sign|((uint32_t)(e+112)<<23)|((m&0x3ff)<<13);
+            }
+        }
+        else if(e==31) x=sign|0x7f800000|(m<<13);
+        else x=sign|((uint32_t)(e+112)<<23)|(m<<13);
+        memcpy(&f, &x, 4);
+        return f;
+    }
+
+    uint16_t float_to_bf16(float f)
+    {
+        uint32_t x=0;
+        memcpy(&x, &f, 4);
+        if((x&0x7fffffff)>0x7f800000) return (x>>16)|0x40;
+        return (x+0x7fff+((x>>16)&1))>>16;
+    }
+
+    float bf16_to_float(uint16_t h)
+    {
+        uint32_t x=(uint32_t)h<<16;
+        float f=0.0;
+        memcpy(&f, &x, 4);
+        return f;
+    }
+
+    // chunk boundaries of about CHUNK_SIZE elements
+    void chunk_rows(unsigned long n, vector<uint64_t> &rows)
+    {
+        unsigned long i=0, size=0;
+        rows.clear();
+        for(i=0; i<n; i++){
+            if(size==0) rows.push_back(i);
+            size+=i+1;
+            if(size>=CHUNK_SIZE) size=0;
+        }
+        rows.push_back(n);
+    }
+
+    // deflate the elements t_start to t_end-1 of A, byte-shuffled
+    bool pack_chunk(const float *A, unsigned long t_start, unsigned long t_end, int type, vector<unsigned char> &out, uint32_t &crc)
+    {
+        unsigned long i=0, b=0, m=t_end-t_start;
+        int s=elem_size(type);
+        vector<unsigned char> raw(m*s), shuf(m*s);
+        if(type==F32) memcpy(&raw[0], A+t_start, m*4);
+        else{
+            uint16_t *p=(uint16_t *)&raw[0];
+            if(type==F16) for(i=0; i<m; i++) p[i]=float_to_half(A[t_start+i]);
+            else for(i=0; i<m; i++) p[i]=float_to_bf16(A[t_start+i]);
+        }
+        crc=crc32(0L, &raw[0], raw.size());
+        for(i=0; i<m; i++){
+            for(b=0; b<s; b++) shuf[b*m+i]=raw[i*s+b];
+        }
+        uLongf size=compressBound(shuf.size());
+        out.resize(size);
+        if(compress2(&out[0], &size, &shuf[0], shuf.size(), Z_BEST_SPEED)!=Z_OK) return false;
+        out.resize(size);
+        return true;
+    }
+
+    // 0 if fine, 1 if the chunk can not be decompressed, 2 if the checksum does not match
+    int unpack_chunk(const vector<unsigned char> &in, unsigned long m, int type, uint32_t crc, float *A)
+    {
+        unsigned long i=0, b=0;
+        int s=elem_size(type);
+        vector<unsigned char> raw(m*s), shuf(m*s);
+        uLongf size=shuf.size();
+        if(uncompress(&shuf[0], &size, &in[0], in.size())!=Z_OK || size!=shuf.size()) return 1;
+        for(i=0; i<m; i++){
+            for(b=0; b<s; b++) raw[i*s+b]=shuf[b*m+i];
+        }
+        if(crc32(0L, &raw[0], raw.size())!=crc) return 2;
+        if(type==F32) memcpy(A, &raw[0], m*4);
+        else{
+            const uint16_t *p=(const uint16_t *)&raw[0];
+            if(type==F16) for(i=0; i<m; i++) A[i]=half_to_float(p[i]);
+            else for(i=0; i<m; i++) A[i]=bf16_to_float(p[i]);
+        }
+        return 0;
+    }
+
+    void read_header(ifstream &in, string file, Header &head, vector<uint64_t> &rows, vector<Chunk> &chunk)
+    {
+        if(!in.read((char *)&head, sizeof(Header)) || memcmp(head.magic, MAGIC, 8)!=0) throw("Error: ["+file+"] is not a GRM file in the .grm.cbin format.");
+        if(head.version!=VERSION || head.type>BF16) throw("Error: unsupported version of the .grm.cbin format in ["+file+"].");
+        rows.resize(head.chunk_num+1);
+        chunk.resize(head.chunk_num*2);
+        if(!in.read((char *)&rows[0], rows.size()*sizeof(uint64_t)) || !in.read((char *)&chunk[0], chunk.size()*sizeof(Chunk))) throw("Error: the header of ["+file+"] is incomplete?");
+        if(rows.back()!=head.n) throw("Error: the header of ["+file+"] is corrupted?");
+    }
+}
+
+void GrmCbin::write(string file, const float *A, const float *A_N, unsigned long n, int type)
+{
+    long c=0, c_end=0, b=0, batch=2*omp_get_max_threads();
+    Header head;
+    vector<uint64_t> rows;
+    chunk_rows(n, rows);
+    memcpy(head.magic, MAGIC, 8);
+    head.version=VERSION;
+    head.type=type;
+    head.n=n;
+    head.chunk_num=rows.size()-1;
+    vector<Chunk> chunk(head.chunk_num*2);
+
+    ofstream out(file.c_str(), ios::out|ios::binary);
+    if(!out) throw("Error: can not open the file ["+file+"] to write.");
+    out.write((char *)&head, sizeof(Header));
+    out.write((char *)&rows[0], rows.size()*sizeof(uint64_t));
+    out.write((char *)&chunk[0], chunk.size()*sizeof(Chunk));
+    uint64_t offset=out.tellp();
+
+    // chunks of the GRM then of the number of SNPs, compressed a batch at a time
+    vector< vector<unsigned char> > buf(batch);
+    bool err_flag=false;
+    for(c=0; c<chunk.size(); c=c_end){
+        c_end=c+batch;
+        if(c_end>chunk.size()) c_end=chunk.size();
+        #pragma omp parallel for schedule(dynamic) reduction(||:err_flag)
+        for(b=c; b<c_end; b++){
+            long k=b%head.chunk_num;
+            unsigned long t_start=rows[k]*(rows[k]+1)/2, t_end=rows[k+1]*(rows[k+1]+1)/2;
+            bool ok=(b<head.chunk_num)?pack_chunk(A, t_start, t_end, type, buf[b-c], chunk[b].crc):pack_chunk(A_N, t_start, t_end, F32, buf[b-c], chunk[b].crc);
+            if(!ok) err_flag=true;
+        }
+        if(err_flag) throw("Error: failed to compress the GRM.");
+        for(b=c; b<c_end; b++){
+            chunk[b].offset=offset;
+            chunk[b].size=buf[b-c].size();
+            out.write((char *)&buf[b-c][0], buf[b-c].size());
+            offset+=buf[b-c].size();
+        }
+    }
+    out.seekp(sizeof(Header)+rows.size()*sizeof(uint64_t));
+    out.write((char *)&chunk[0], chunk.size()*sizeof(Chunk));
+    out.close();
+    if(!out) throw("Error: failed to write the file ["+file+"].");
+}
+
+unsigned long GrmCbin::indi_num(string file)
+{
+    ifstream in(file.c_str(), ios::in|ios::binary);
+    if(!in) throw("Error: can not open the file ["+file+"] to read.");
+    Header head;
+    vector<uint64_t> rows;
+    vector<Chunk> chunk;
+    read_header(in, file, head, rows, chunk);
+    return head.n;
+}
+
+void GrmCbin::read(string file, bool N_flag, unsigned long r_start, unsigned long r_end, float *A)
+{
+    long c=0, c_end=0, b=0, batch=2*omp_get_max_threads();
+    ifstream in(file.c_str(), ios::in|ios::binary);
+    if(!in) throw("Error: can not open the file ["+file+"] to read.");
+    Header head;
+    vector<uint64_t> rows;
+    vector<Chunk> chunk;
+    read_header(in, file, head, rows, chunk);
+    if(r_end>head.n || r_start>r_end) throw("Error: the rows to read are out of the range of the GRM in ["+file+"].");
+    int type=N_flag?(int)F32:(int)head.type;
+    unsigned long t_start=r_start*(r_start+1)/2, t_end=r_end*(r_end+1)/2;
+
+    // chunks overlapping the rows
+    long k_start=0, k_end=head.chunk_num;
+    while(k_start<head.chunk_num && rows[k_start+1]<=r_start) k_start++;
+    while(k_end>k_start && rows[k_end-1]>=r_end) k_end--;
+    long shift=N_flag?head.chunk_num:0;
+
+    vector< vector<unsigned char> > buf(batch);
+    int err=0;
+    for(c=k_start; c<k_end; c=c_end){
+        c_end=c+batch;
+        if(c_end>k_end) c_end=k_end;
+        for(b=c; b<c_end; b++){
+            const Chunk &ck=chunk[b+shift];
+            buf[b-c].resize(ck.size);
+            in.seekg(ck.offset);
+            if(!in.read((char *)&buf[b-c][0], ck.size)) throw("Error: the file ["+file+"] is incomplete?");
+        }
+        #pragma omp parallel for schedule(dynamic)
+        for(b=c; b<c_end; b++){
+            unsigned long s=rows[b]*(rows[b]+1)/2, e=rows[b+1]*(rows[b+1]+1)/2;
+            int status=0;
+            if(s>=t_start && e<=t_end) status=unpack_chunk(buf[b-c], e-s, type, chunk[b+shift].crc, A+s-t_start);
+            else{
+                // a chunk at either end of the rows
+                vector<float> tmp(e-s);
+                status=unpack_chunk(buf[b-c], e-s, type, chunk[b+shift].crc, &tmp[0]);
+                unsigned long l_start=(s>t_start)?s:t_start, l_end=(e<t_end)?e:t_end;
+                if(status==0) memcpy(A+l_start-t_start, &tmp[l_start-s], (l_end-l_start)*sizeof(float));
+            }
+            if(status>0){
+                #pragma omp critical
+                err=status;
+            }
+        }
+        if(err==1) throw("Error: failed to decompress a chunk of ["+file+"]. The file is corrupted?");
+        if(err==2) throw("Error: checksum mismatch in a chunk of ["+file+"]. The file is corrupted?");
+    }
+}
@@ -0,0 +1,47 @@
+/*
+ * GCTA: a tool for Genome-wide Complex Trait Analysis
+ *
+ * Interface to the chunked, compressed GRM file (.grm.cbin)
+ *
+ * The file holds the lower triangles, packed by row, of the GRM and of the
+ * number of SNPs behind each element. Both are cut at the same row boundaries
+ * into chunks of about 2^20 elements; each chunk is byte-shuffled, deflated
+ * on its own at the fastest level and checked by the CRC32 of its uncompressed
+ * bytes, so chunks are (de)compressed in parallel and a block of rows is read
+ * without touching the rest of the file. The GRM may be stored as float, float16 or bfloat16; the
+ * number of SNPs is always stored as float.
+ *
+ * Layout (little endian):
+ *   header     "GCTAGRM2", uint32 version, uint32 GRM element type,
+ *              uint64 number of individuals, uint64 number of chunks
+ *   rows       uint64 first row of each chunk, then the number of individuals
+ *   index      uint64 offset, uint32 compressed size and uint32 CRC32 for each
+ *              chunk of the GRM, then for each chunk of the number of SNPs
+ *   data       the compressed chunks
+ *
+ * This file is distributed under the GNU General Public
+ * License, Version 2.  Please see the file COPYING for more
+ * details
+ */
+
+#ifndef _GRMCBIN_H
+#define _GRMCBIN_H
+
+#include <string>
+using namespace std;
+
+namespace GrmCbin
+{
+    enum {F32=0, F16=1, BF16=2};
+
+    // A and A_N are the packed lower triangles of n individuals
+    void write(string file, const float *A, const float *A_N, unsigned long n, int type);
+
+    // number of individuals in the file
+    unsigned long indi_num(string file);
+
+    // rows r_start to r_end-1 of the GRM, or of the number of SNPs if N_flag is true, into A packed from row r_start
+    void read(string file, bool N_flag, unsigned long r_start, unsigned long r_end, float *A);
+}
+
+#endif
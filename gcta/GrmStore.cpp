@@ -0,0 +1,122 @@
+/*
+ * GCTA: a tool for Genome-wide Complex Trait Analysis
+ *
+ * Implementations of the packed GRM store
+ *
+ * This file is distributed under the GNU General Public
+ * License, Version 2.  Please see the file COPYING for more
+ * details
+ */
+
+#include "GrmStore.h"
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+GrmStore::GrmStore()
+{
+    _A=NULL;
+    _n=_map_size=0;
+}
+
+GrmStore::~GrmStore()
+{
+    clear();
+}
+
+void GrmStore::clear()
+{
+    if(_A!=NULL){
+        if(_map_size>0) munmap(_A, _map_size);
+        else free(_A);
+    }
+    _A=NULL;
+    _n=_map_size=0;
+}
+
+void GrmStore::init(unsigned long n)
+{
+    clear();
+    if(n<1) return;
+    _A=(float *)calloc(n*(n+1)/2, sizeof(float));
+    if(_A==NULL) throw("Error: insufficient memory to store the GRM.");
+    _n=n;
+}
+
+void GrmStore::map(string file, unsigned long n)
+{
+    clear();
+    if(n<1) return;
+    unsigned long size=n*(n+1)/2*sizeof(float);
+    int fd=open(file.c_str(), O_RDONLY);
+    if(fd<0) throw("Error: can not open the file ["+file+"] to read.");
+    struct stat st;
+    if(fstat(fd, &st)!=0 || (unsigned long)st.st_size!=size){
+        close(fd);
+        throw("Error: the size of the ["+file+"] file does not match the number of IDs. The file is incomplete?");
+    }
+    // private mapping: elements changed in memory (e.g. by --grm-adj) are not written back to the file
+    void *p=mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(p==MAP_FAILED) throw("Error: can not map the file ["+file+"] into memory.");
+    _A=(float *)p;
+    _n=n;
+    _map_size=size;
+}
+
+void GrmStore::subset(const vector<int> &kp)
+{
+    // element (i,j) moves to an earlier position, never to one that is still to be read
+    unsigned long i=0, j=0, k=0, m=kp.size();
+    for(i=0; i<m; i++){
+        float *p=_A+(unsigned long)kp[i]*(kp[i]+1)/2;
+        for(j=0; j<=i; j++, k++) _A[k]=p[kp[j]];
+    }
+    _n=m;
+}
+
+template<class T>
+static void fill_grm(const GrmStore &G, const vector<int> &kp, T *A)
+{
+    long i=0, j=0, k=0, l=0, n=kp.size(), i_end=0, j_end=0;
+
+    // upper triangle column by column: contiguous writes, and contiguous reads if kp is sorted
+    #pragma omp parallel for private(j) schedule(dynamic, 64)
+    for(i=0; i<n; i++){
+        const float *p=G.data()+(unsigned long)kp[i]*(kp[i]+1)/2;
+        T *a=A+(unsigned long)i*n;
+        for(j=0; j<=i; j++) a[j]=(kp[j]<=kp[i])?p[kp[j]]:G(kp[j], kp[i]);
+    }
+
+    // lower triangle from the upper one in tiles
+    #pragma omp parallel for private(j, k, l, i_end, j_end) schedule(dynamic)
+    for(i=0; i<n; i+=64){
+        i_end=(i+64<n)?i+64:n;
+        for(j=0; j<=i; j+=64){
+            j_end=(j+64<n)?j+64:n;
+            for(k=i; k<i_end; k++){
+                for(l=j; l<j_end && l<k; l++) A[l*n+k]=A[k*n+l];
+            }
+        }
+    }
+}
+
+void GrmStore::fill(const vector<int> &kp, double *A) const
+{
+    fill_grm(*this, kp, A);
+}
+
+void GrmStore::fill(const vector<int> &kp, float *A) const
+{
+    fill_grm(*this, kp, A);
+}
+
+void GrmStore::swap(GrmStore &A)
+{
+    float *p=_A;
+    unsigned long n=_n, map_size=_map_size;
+    _A=A._A; _n=A._n; _map_size=A._map_size;
+    A._A=p; A._n=n; A._map_size=map_size;
+}
@@ -0,0 +1,60 @@
+/*
+ * GCTA: a tool for Genome-wide Complex Trait Analysis
+ *
+ * Interface to the packed GRM store
+ *
+ * A symmetric matrix of floats (the GRM or the number of SNPs behind it) is kept
+ * as its lower triangle packed by row, element (i,j) with j<=i at i*(i+1)/2+j,
+ * i.e. in the layout of the .grm.bin and .grm.N.bin files. The store either owns
+ * the memory or maps one of these files privately, in which case pages are read
+ * when first touched and copied only when written.
+ *
+ * This file is distributed under the GNU General Public
+ * License, Version 2.  Please see the file COPYING for more
+ * details
+ */
+
+#ifndef _GRMSTORE_H
+#define _GRMSTORE_H
+
+#include <string>
+#include <vector>
+using namespace std;
+
+class GrmStore
+{
+public:
+    GrmStore();
+    ~GrmStore();
+
+    void init(unsigned long n); // all elements are set to zero
+    void map(string file, unsigned long n);
+    void clear();
+
+    unsigned long n() const {return _n;}
+    bool empty() const {return _n==0;}
+    float *data() {return _A;}
+    const float *data() const {return _A;}
+
+    // element (i,j), either triangle
+    float operator()(unsigned long i, unsigned long j) const {return i>=j?_A[i*(i+1)/2+j]:_A[j*(j+1)/2+i];}
+    float &operator()(unsigned long i, unsigned long j) {return i>=j?_A[i*(i+1)/2+j]:_A[j*(j+1)/2+i];}
+
+    // keep the rows and columns in kp (sorted), in place
+    void subset(const vector<int> &kp);
+
+    // the rows and columns in kp (any order) as a full n x n column-major matrix, n=kp.size()
+    void fill(const vector<int> &kp, double *A) const;
+    void fill(const vector<int> &kp, float *A) const;
+    void swap(GrmStore &A);
+
+private:
+    GrmStore(const GrmStore &);
+    GrmStore &operator=(const GrmStore &);
+
+    float *_A;
+    unsigned long _n;
+    unsigned long _map_size; // size of the mapping in bytes, 0 if the memory is owned
+};
+
+#endif
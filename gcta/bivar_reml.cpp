@@ -61,7 +61,7 @@ void gcta::fit_bivar_reml(string grm_file, string phen_file, string qcovar_file,
         if(!sex_file.empty()) update_sex(sex_file);
         if(adj_grm_fac>-1.0) adj_grm(adj_grm_fac);
         if(dosage_compen>-1) dc(dosage_compen);
-        _grm_N.resize(0,0);
+        _grm_N.clear();
     }
     
     vector<string> uni_id;
@@ -172,7 +172,7 @@ void gcta::fit_bivar_reml(string grm_file, string phen_file, string qcovar_file,
         pos++;
         
         for(j=0; j<pos; j++) (_Asp[j]).finalize();
-        _grm.resize(0,0);
+        _grm.clear();
     }
     else if(m_grm_flag){
         if(!sex_file.empty()) update_sex(sex_file);
@@ -221,8 +221,8 @@ void gcta::fit_bivar_reml(string grm_file, string phen_file, string qcovar_file,
             prev_file=grm_files[k];
             prev_grm_id=grm_id;
         }
-        _grm_N.resize(0,0);
-        _grm.resize(0,0);
+        _grm_N.clear();
+        _grm.clear();
     }
     
     _bivar_pos[0].push_back(pos);
@@ -18,6 +18,10 @@ gcta::gcta(int autosome_num, string out)
     _out=out;
     _dosage_flag=false;
 	_grm_bin_flag=false;
+    _geno_block=0;
+    _grm_part_num=_grm_part=0;
+    _grm_cbin_flag=false;
+    _grm_cbin_type=-1;
     _reml_mtd=0;
     _reml_inv_mtd=0;
     _reml_max_iter=30;
@@ -38,12 +42,19 @@ gcta::gcta(int autosome_num, string out)
     _flag_CC2=false;
     _reml_have_bend_A=false;
     _V_inv_mtd=0;
+    _reml_sparse=false;
+    _reml_spectral=false;
+    _reml_precision=0;
 }
 
 gcta::gcta()
 {
     _dosage_flag=false;
 	_grm_bin_flag=false;
+    _geno_block=0;
+    _grm_part_num=_grm_part=0;
+    _grm_cbin_flag=false;
+    _grm_cbin_type=-1;
     _reml_mtd=0;
     _reml_inv_mtd=0;
     _reml_max_iter=30;
@@ -64,6 +75,9 @@ gcta::gcta()
     _flag_CC2=false;
     _reml_have_bend_A=false;
     _V_inv_mtd=0;
+    _reml_sparse=false;
+    _reml_spectral=false;
+    _reml_precision=0;
 }
 
 gcta::~gcta()
@@ -183,7 +197,7 @@ void gcta::init_include()
 // some code are adopted from PLINK with modifications
 void gcta::read_bedfile(string bedfile)
 {
-	int i=0, j=0, k=0;
+	int i=0, j=0;
 
 	// Flag for reading individuals and SNPs
 	vector<int> rindi, rsnp;
@@ -194,50 +208,72 @@ void gcta::read_bedfile(string bedfile)
 	if(_keep.size()==0) throw("Error: No individual is retained for analysis.");
 
 	// Read bed file
-    char ch[1];
-    bitset<8> b;
-    _snp_1.resize(_include.size());
-    _snp_2.resize(_include.size());
-    for(i=0; i<_include.size(); i++){
-        _snp_1[i].reserve(_keep.size());
-        _snp_2[i].reserve(_keep.size());
-    }
-	fstream BIT(bedfile.c_str(), ios::in|ios::binary);
-	if(!BIT) throw("Error: can not open the file ["+bedfile+"] to read.");
-	cout<<"Reading PLINK BED file from ["+bedfile+"] in SNP-major format ..."<<endl;
-    for(i=0; i<3; i++) BIT.read(ch,1); // skip the first three bytes
-    int snp_indx=0, indi_indx=0;
-    for(j=0, snp_indx=0; j<_snp_num; j++){ // Read genotype in SNP-major mode, 00: homozygote AA; 11: homozygote BB; 01: hetezygote; 10: missing
-        if(!rsnp[j]){
-            for(i=0; i<_indi_num; i+=4) BIT.read(ch,1);
-            continue;
+    vector<int> kp;
+    if(_keep.size()<_indi_num){
+        for(i=0; i<_indi_num; i++){
+            if(rindi[i]) kp.push_back(i);
         }
-        for(i=0, indi_indx=0; i<_indi_num;){
-			BIT.read(ch,1);
-            if(!BIT) throw("Error: problem with the BED file ... has the FAM/BIM file been changed?");
-            b=ch[0];
-            k=0;
-            while(k < 7 && i < _indi_num){ // change code: 11 for AA; 00 for BB;
-                if(!rindi[i]) k+=2;
-                else{
-                    _snp_2[snp_indx][indi_indx]=(!b[k++]);
-                    _snp_1[snp_indx][indi_indx]=(!b[k++]);
-                    indi_indx++;
-                }
-                i++;
-           }
-		}
-		if(snp_indx==_include.size()) break;
-		snp_indx++;
     }
-	BIT.clear();
-    BIT.close();
+    vector<int> snp_pos;
+    for(j=0; j<_snp_num; j++){
+        if(rsnp[j]) snp_pos.push_back(j);
+    }
+    if(_geno_block>0){
+        // the genotypes are read block by block at the time of analysis
+        _bed.open(bedfile, _snp_num, _indi_num);
+        _bed_snp_pos=snp_pos;
+        _bed_indi_pos=kp;
+        cout<<"Genotype data for "<<_keep.size()<<" individuals and "<<_include.size()<<" SNPs to be read from ["+bedfile+"] in blocks of "<<_geno_block<<" SNPs."<<endl;
+        update_fam(rindi);
+        update_bim(rsnp);
+        return;
+    }
+    _geno.init(_include.size(), _keep.size());
+    BedFile bed;
+    bed.open(bedfile, _snp_num, _indi_num);
+	cout<<"Reading PLINK BED file from ["+bedfile+"] in SNP-major format ..."<<endl;
+    bed.advise(_include.size()<_snp_num/10);
+    // Read genotype in SNP-major mode, 00: homozygote AA; 11: homozygote BB; 01: hetezygote; 10: missing
+    // each thread decodes a contiguous range of SNPs into its own part of the genotype store
+    #pragma omp parallel for schedule(static)
+    for(j=0; j<snp_pos.size(); j++) _geno.read_bed_snp(j, bed.snp_ptr(snp_pos[j]), _indi_num, kp);
+    bed.close();
 	cout<<"Genotype data for "<<_keep.size()<<" individuals and "<<_include.size()<<" SNPs to be included from ["+bedfile+"]."<<endl;
 
     update_fam(rindi);
 	update_bim(rsnp);
 }
 
+void gcta::enable_geno_stream(int block_size)
+{
+    _geno_block=block_size;
+}
+
+void gcta::load_geno_block(int j_start, int j_end)
+{
+    // genotypes of the included SNPs j_start to j_end-1 (_geno.snp_ptr(j)) for the individuals in _keep only
+    int i=0, j=0;
+    vector<int> kp;
+    if(_keep.size()<_bed.indi_num()){
+        kp.resize(_keep.size());
+        for(i=0; i<_keep.size(); i++) kp[i]=(_bed_indi_pos.empty()?_keep[i]:_bed_indi_pos[_keep[i]]);
+    }
+    if(_geno_kp.size()!=_keep.size()){
+        _geno_kp.resize(_keep.size());
+        for(i=0; i<_keep.size(); i++) _geno_kp[i]=i;
+    }
+    _geno.init(j_end-j_start, _keep.size(), j_start);
+    #pragma omp parallel for
+    for(j=j_start; j<j_end; j++) _geno.read_bed_snp(j, _bed.snp_ptr(_bed_snp_pos[_include[j]]), _bed.indi_num(), kp);
+
+    // read ahead the next block while this one is in use
+    if(j_end<_include.size()){
+        int j_next=j_end+(j_end-j_start);
+        if(j_next>_include.size()) j_next=_include.size();
+        _bed.prefetch(_bed_snp_pos[_include[j_end]], _bed_snp_pos[_include[j_next-1]]);
+    }
+}
+
 void gcta::get_rsnp(vector<int> &rsnp)
 {
     rsnp.clear();
@@ -260,7 +296,7 @@ void gcta::get_rindi(vector<int> &rindi)
 
 void gcta::update_bim(vector<int> &rsnp)
 {
-    int i=0;
+    int i=0, k=0;
 
 	//update bim information
 	vector<int> chr_buf, bp_buf;
@@ -280,6 +316,16 @@ void gcta::update_bim(vector<int> &rsnp)
 	}
 	_chr.clear(); _snp_name.clear(); _genet_dst.clear(); _bp.clear(); _allele1.clear(); _allele2.clear(); _ref_A.clear(); _other_A.clear();
 	_chr=chr_buf; _snp_name=snp_name_buf; _genet_dst=genet_dst_buf; _bp=bp_buf; _allele1=a1_buf; _allele2=a2_buf; _ref_A=ref_A_buf; _other_A=other_A_buf;
+
+    // allele frequencies and rows of the SNP loadings read before the genotypes (read_pc_loading) follow the SNPs
+    if(_mu.size()==_snp_num){
+        for(i=0, k=0; i<_snp_num; i++){ if(rsnp[i]) _mu[k++]=_mu[i]; }
+        _mu.resize(k);
+    }
+    if(_pc_load_indx.size()==_snp_num){
+        for(i=0, k=0; i<_snp_num; i++){ if(rsnp[i]) _pc_load_indx[k++]=_pc_load_indx[i]; }
+        _pc_load_indx.resize(k);
+    }
 	_snp_num=_chr.size();
 	_include.clear();
 	_include.resize(_snp_num);
@@ -629,19 +675,17 @@ void gcta::save_bedfile()
     b.set(0);
     ch[0] = (char)b.to_ulong();
     OutBed.write(ch,1);
+    vector<unsigned char> code(_keep.size());
+    vector<char> buf((_keep.size()+3)/4);
     for(i=0; i<_include.size(); i++){
-        pos=0;
-        b.reset();
-        for(j=0; j<_keep.size(); j++){
-            b[pos++]=(!_snp_2[_include[i]][_keep[j]]);
-            b[pos++]=(!_snp_1[_include[i]][_keep[j]]);
-            if(pos>7 || j==_keep.size()-1){
-                ch[0]=(char)b.to_ulong();
-                OutBed.write(ch,1);
-                pos=0;
-                b.reset();
-            }
+        _geno.get_snp(_include[i], _keep, &code[0]);
+        for(j=0, pos=0; j<_keep.size(); j+=4, pos++){
+            buf[pos]=(char)code[j];
+            if(j+1<_keep.size()) buf[pos]|=(char)(code[j+1]<<2);
+            if(j+2<_keep.size()) buf[pos]|=(char)(code[j+2]<<4);
+            if(j+3<_keep.size()) buf[pos]|=(char)(code[j+3]<<6);
         }
+        OutBed.write(&buf[0], buf.size());
     }
     OutBed.close();
 }
@@ -680,23 +724,14 @@ void gcta::dose2bed()
 	double d_buf=0.0;
 	
 	cout<<"Converting dosage data into PLINK binary PED format ... "<<endl;
-    _snp_1.resize(_snp_num);
-    _snp_2.resize(_snp_num);
+    _geno.init(_snp_num, _indi_num);
     for(i=0; i<_include.size(); i++){
-        _snp_1[i].resize(_indi_num);
-        _snp_2[i].resize(_indi_num);
 		for(j=0; j<_keep.size(); j++){
 			d_buf=_geno_dose[_keep[j]][_include[i]];
-            if(d_buf>1e5){
-				_snp_2[_include[i]][_keep[j]]=false;
-                _snp_1[_include[i]][_keep[j]]=true;
-            }
-			else if(d_buf>=1.5) _snp_1[_include[i]][_keep[j]]=_snp_2[_include[i]][_keep[j]]=true;
-			else if(d_buf>0.5){
-				_snp_2[_include[i]][_keep[j]]=true;
-				_snp_1[_include[i]][_keep[j]]=false;
-			}
-			else if(d_buf<=0.5) _snp_1[_include[i]][_keep[j]]=_snp_2[_include[i]][_keep[j]]=false;
+            if(d_buf>1e5) _geno.set(_include[i], _keep[j], 1);
+			else if(d_buf>=1.5) _geno.set(_include[i], _keep[j], 0);
+			else if(d_buf>0.5) _geno.set(_include[i], _keep[j], 2);
+			else if(d_buf<=0.5) _geno.set(_include[i], _keep[j], 3);
 		}
     }
 }
@@ -965,6 +1000,25 @@ void gcta::update_ref_A(string ref_A_file)
 }
 
 void gcta::calcu_mu(bool ssq_flag)
+{
+	int j=0;
+
+    cout<<"Calculating allele frequencies ..."<<endl;
+    _mu.clear();
+	_mu.resize(_snp_num);
+	
+    if(_geno_block>0 && !_dosage_flag){
+        for(j=0; j<_include.size(); j+=_geno_block){
+            int j_end=j+_geno_block;
+            if(j_end>_include.size()) j_end=_include.size();
+            load_geno_block(j, j_end);
+            calcu_mu_block(j, j_end);
+        }
+    }
+    else calcu_mu_block(0, _include.size());
+}
+
+void gcta::calcu_mu_block(int j_start, int j_end)
 {
 	int i=0, j=0;
 
@@ -976,12 +1030,8 @@ void gcta::calcu_mu(bool ssq_flag)
         fac[i]=0.5;
     }
 
-    cout<<"Calculating allele frequencies ..."<<endl;
-    _mu.clear();
-	_mu.resize(_snp_num);
-	
 	#pragma omp parallel for
-    for(j=0; j<_include.size(); j++){
+    for(j=j_start; j<j_end; j++){
         if(_chr[_include[j]]<(_autosome_num+1)) mu_func(j, auto_fac);
         else if(_chr[_include[j]]==(_autosome_num+1)) mu_func(j, xfac);
         else mu_func(j, fac);
@@ -1001,9 +1051,11 @@ void gcta::mu_func(int j, vector<double> &fac)
         }
     }
     else{
+        vector<unsigned char> code(_keep.size());
+        _geno.get_snp(geno_snp(j), geno_keep(), &code[0]);
         for(i=0; i<_keep.size(); i++){
-            if(!_snp_1[_include[j]][_keep[i]] || _snp_2[_include[j]][_keep[i]]){
-                f_buf=(_snp_1[_include[j]][_keep[i]]+_snp_2[_include[j]][_keep[i]]);
+            if(!GenoStore::miss(code[i])){
+                f_buf=GenoStore::dose(code[i]);
                 if(_allele2[_include[j]]==_ref_A[_include[j]]) f_buf=2.0-f_buf;
                 _mu[_include[j]]+=fac[i]*f_buf;
                 fcount+=fac[i];
@@ -1082,6 +1134,61 @@ void gcta::update_freq(string freq)
     if(icount!=_snp_num) cout<<"Warning: allele frequencies of "<<_snp_num-icount<<" SNPs have not been updated."<<endl;
 }
 
+void gcta::read_pc_loading(string pcl_file)
+{
+    // SNP loadings from --pca-loading: the SNPs are restricted to those in the file, the counted allele and
+    // the allele frequency are taken from the file so that the genotypes are standardised as in the reference
+    ifstream i_pcl(pcl_file.c_str());
+    if(!i_pcl) throw("Error: can not open the file ["+pcl_file+"] to read.");
+    cout<<"Reading SNP loadings of the principal components from ["+pcl_file+"]."<<endl;
+    int i=0, j=0, k=0, line=1;
+    string str_buf;
+    vector<string> vs_buf;
+    getline(i_pcl, str_buf);
+    k=StrFunc::split_string(str_buf, vs_buf)-4;
+    if(k<1 || vs_buf[0]!="SNP") throw("Error: ["+pcl_file+"] is not a file of SNP loadings generated by --pca-loading.");
+    map<string, int>::iterator iter, End=_snp_name_map.end();
+    vector<string> snplist;
+    vector< vector<float> > load;
+    _mu.clear();
+    _mu.resize(_snp_num, 0.0);
+    int allele_miss=0;
+    while(getline(i_pcl, str_buf)){
+        line++;
+        if(StrFunc::split_string(str_buf, vs_buf)!=k+4){
+            stringstream errmsg;
+            errmsg<<"Error: line "<<line<<" of the file ["+pcl_file+"] should have "<<k+4<<" columns.";
+            throw(errmsg.str());
+        }
+        iter=_snp_name_map.find(vs_buf[0]);
+        if(iter==End) continue;
+        j=iter->second;
+        if(vs_buf[1]==_allele1[j] && vs_buf[2]==_allele2[j]){ _ref_A[j]=_allele1[j]; _other_A[j]=_allele2[j]; }
+        else if(vs_buf[1]==_allele2[j] && vs_buf[2]==_allele1[j]){ _ref_A[j]=_allele2[j]; _other_A[j]=_allele1[j]; }
+        else{
+            allele_miss++;
+            continue;
+        }
+        _mu[j]=atof(vs_buf[3].c_str())*2.0;
+        snplist.push_back(vs_buf[0]);
+        load.push_back(vector<float>(k));
+        for(i=0; i<k; i++) load.back()[i]=atof(vs_buf[i+4].c_str());
+    }
+    i_pcl.close();
+
+    _pc_load.resize(load.size(), k);
+    _pc_load_indx.clear();
+    _pc_load_indx.resize(_snp_num, -1);
+    for(j=0; j<load.size(); j++){
+        for(i=0; i<k; i++) _pc_load(j,i)=load[j][i];
+        _pc_load_indx[_snp_name_map[snplist[j]]]=j;
+    }
+    update_id_map_kp(snplist, _snp_name_map, _include);
+    if(allele_miss>0) cout<<"Warning: "<<allele_miss<<" SNPs are excluded because the alleles do not match those in ["+pcl_file+"]."<<endl;
+    if(_include.empty()) throw("Error: none of the SNPs in ["+pcl_file+"] is in the data.");
+    cout<<"SNP loadings of "<<k<<" principal components for "<<_include.size()<<" SNPs are included from ["+pcl_file+"]."<<endl;
+}
+
 void gcta::save_freq(bool ssq_flag)
 {
     if(_mu.empty()) calcu_mu(ssq_flag);
@@ -1139,7 +1246,7 @@ void gcta::make_XMat(vector< vector<float> > &X, bool miss_with_mu)
     if(_mu.empty() && miss_with_mu) calcu_mu();
 
 	cout<<"Recoding genotypes (individual major mode) ..."<<endl;
-	int i=0, j=0;
+	int i=0, j=0, code=0;
 	X.clear();
 	X.resize(_keep.size());
 	
@@ -1158,9 +1265,10 @@ void gcta::make_XMat(vector< vector<float> > &X, bool miss_with_mu)
 		}
 		else{
             for(j=0; j<_include.size(); j++){
-                if(!_snp_1[_include[j]][_keep[i]] || _snp_2[_include[j]][_keep[i]]){
-                    if(_allele1[_include[j]]==_ref_A[_include[j]]) X[i][j]=_snp_1[_include[j]][_keep[i]]+_snp_2[_include[j]][_keep[i]];
-                    else X[i][j]=2.0-(_snp_1[_include[j]][_keep[i]]+_snp_2[_include[j]][_keep[i]]);
+                code=_geno.get(_include[j], _keep[i]);
+                if(!GenoStore::miss(code)){
+                    if(_allele1[_include[j]]==_ref_A[_include[j]]) X[i][j]=GenoStore::dose(code);
+                    else X[i][j]=2.0-GenoStore::dose(code);
                 }
                 else{ X[i][j]=1e6; need2fill=true; }
             }
@@ -1220,7 +1328,7 @@ void gcta::make_XMat_SNPs(vector< vector<float> > &X, bool miss_with_mu)
     if(_mu.empty() && miss_with_mu) calcu_mu();
 
 	cout<<"Recoding genotypes (SNP major mode) ..."<<endl;
-	int i=0, j=0;
+	int i=0, j=0, code=0;
 	X.clear();
 	X.resize(_include.size());
 	for(i=0; i<_include.size(); i++) X[i].resize(_keep.size());
@@ -1238,9 +1346,10 @@ void gcta::make_XMat_SNPs(vector< vector<float> > &X, bool miss_with_mu)
 		}
 		else{
             for(j=0; j<_include.size(); j++){
-                if(!_snp_1[_include[j]][_keep[i]] || _snp_2[_include[j]][_keep[i]]){
-                    if(_allele1[_include[j]]==_ref_A[_include[j]]) X[j][i]=(_snp_1[_include[j]][_keep[i]]+_snp_2[_include[j]][_keep[i]]);
-                    else X[j][i]=2.0-(_snp_1[_include[j]][_keep[i]]+_snp_2[_include[j]][_keep[i]]);
+                code=_geno.get(_include[j], _keep[i]);
+                if(!GenoStore::miss(code)){
+                    if(_allele1[_include[j]]==_ref_A[_include[j]]) X[j][i]=GenoStore::dose(code);
+                    else X[j][i]=2.0-GenoStore::dose(code);
                 }
                 else{ X[j][i]=1e6; need2fill=true; }
             }
@@ -1297,15 +1406,13 @@ void gcta::std_XMat_SNPs(vector< vector<float> > &X, vector<double> &sd_SNP, boo
 void gcta::makex_eigenVector(int j, eigenVector &x, bool resize, bool minus_2p)
 {
     int i=0;
+    eigenVector::Scalar val[4];
     if(resize) x.resize(_keep.size());
-    for(i=0; i<_keep.size(); i++){
-        if(!_snp_1[_include[j]][_keep[i]] || _snp_2[_include[j]][_keep[i]]){
-            if(_allele1[_include[j]]==_ref_A[_include[j]]) x[i]=(_snp_1[_include[j]][_keep[i]]+_snp_2[_include[j]][_keep[i]]);
-            else x[i]=2.0-(_snp_1[_include[j]][_keep[i]]+_snp_2[_include[j]][_keep[i]]);
-        }
-        else x[i]=_mu[_include[j]];
-        if(minus_2p) x[i]-=_mu[_include[j]];
+    geno_val(j, val, _mu[_include[j]]);
+    if(minus_2p){
+        for(i=0; i<4; i++) val[i]-=_mu[_include[j]];
     }
+    _geno.get_snp(_include[j], _keep, val, x.data());
 }
 
 void gcta::save_XMat(bool miss_with_mu)
@@ -1318,7 +1425,7 @@ void gcta::save_XMat(bool miss_with_mu)
     zoutf.open( X_zFile.c_str() );
     if(!zoutf.is_open()) throw("Error: can not open the file ["+X_zFile+"] to write.");
 	cout<<"Saving the recoded genotype matrix to the file ["+X_zFile+"]."<<endl;
-    int i=0, j=0;
+    int i=0, j=0, code=0;
     zoutf<<"FID IID ";
     for(j=0; j<_include.size(); j++) zoutf<<_snp_name[_include[j]]<<" ";
     zoutf<<endl;
@@ -1341,9 +1448,10 @@ void gcta::save_XMat(bool miss_with_mu)
 		}
 		else{
             for(j=0; j<_include.size(); j++){
-                if(!_snp_1[_include[j]][_keep[i]] || _snp_2[_include[j]][_keep[i]]){
-                    if(_allele1[_include[j]]==_ref_A[_include[j]]) zoutf<<_snp_1[_include[j]][_keep[i]]+_snp_2[_include[j]][_keep[i]]<<' ';
-                    else zoutf<<2.0-(_snp_1[_include[j]][_keep[i]]+_snp_2[_include[j]][_keep[i]])<<' ';
+                code=_geno.get(_include[j], _keep[i]);
+                if(!GenoStore::miss(code)){
+                    if(_allele1[_include[j]]==_ref_A[_include[j]]) zoutf<<GenoStore::dose(code)<<' ';
+                    else zoutf<<2.0-GenoStore::dose(code)<<' ';
                 }
                 else{
                     if(miss_with_mu) zoutf<<_mu[_include[j]]<<' ';
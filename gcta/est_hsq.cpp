@@ -148,7 +148,7 @@ int gcta::read_GE(string GE_file, vector<string> &GE_ID, vector< vector<string>
     return GE_num;
 }
 
-void gcta::fit_reml(string grm_file, string phen_file, string qcovar_file, string covar_file, string qGE_file, string GE_file, string keep_indi_file, string remove_indi_file, string sex_file, int mphen, double grm_cutoff, double adj_grm_fac, int dosage_compen, bool m_grm_flag, bool pred_rand_eff, bool est_fix_eff, int reml_mtd, int MaxIter, vector<double> reml_priors, vector<double> reml_priors_var, vector<int> drop, bool no_lrt, double prevalence, bool no_constrain, bool mlmassoc, bool within_family, bool reml_bending, bool reml_diag_one)
+void gcta::fit_reml(string grm_file, string phen_file, string qcovar_file, string covar_file, string qGE_file, string GE_file, string keep_indi_file, string remove_indi_file, string sex_file, int mphen, double grm_cutoff, double adj_grm_fac, int dosage_compen, bool m_grm_flag, bool pred_rand_eff, bool est_fix_eff, int reml_mtd, int MaxIter, vector<double> reml_priors, vector<double> reml_priors_var, vector<int> drop, bool no_lrt, double prevalence, bool no_constrain, bool mlmassoc, bool within_family, bool reml_bending, bool reml_diag_one, bool reml_spectral, int reml_precision)
 {
     _reml_mtd=reml_mtd;
     _reml_max_iter=MaxIter;
@@ -206,7 +206,7 @@ void gcta::fit_reml(string grm_file, string phen_file, string qcovar_file, strin
         if(!sex_file.empty()) update_sex(sex_file);
         if(adj_grm_fac>-1.0) adj_grm(adj_grm_fac);
         if(dosage_compen>-1) dc(dosage_compen);
-        _grm_N.resize(0,0);
+        _grm_N.clear();
     }
     
     vector<string> uni_id;
@@ -250,12 +250,8 @@ void gcta::fit_reml(string grm_file, string phen_file, string qcovar_file, strin
         _A.resize(_r_indx.size());
         if(mlmassoc) StrFunc::match(uni_id, grm_id, kp);
         else kp=_keep;
-        (_A[0])=eigenMatrix::Zero(_n, _n);
-		
-		#pragma omp parallel for private(j)
-        for(i=0; i<_n; i++){
-            for(j=0; j<=i; j++) (_A[0])(j,i)=(_A[0])(i,j)=_grm(kp[i],kp[j]);
-        }
+        (_A[0]).resize(_n, _n);
+        _grm.fill(kp, (_A[0]).data());
         if(_reml_diag_one){
             double diag_mean=(_A[0]).diagonal().mean();
             cout<<"Mean of diagonal elements of the GRM = "<<diag_mean<<endl;
@@ -270,7 +266,7 @@ void gcta::fit_reml(string grm_file, string phen_file, string qcovar_file, strin
         }
 		
         pos++;
-        _grm.resize(0,0);
+        _grm.clear();
     }
     else if(m_grm_flag){
         if(!sex_file.empty()) update_sex(sex_file);
@@ -286,15 +282,8 @@ void gcta::fit_reml(string grm_file, string phen_file, string qcovar_file, strin
             if(adj_grm_fac>-1.0) adj_grm(adj_grm_fac);
             if(dosage_compen>-1) dc(dosage_compen);
             StrFunc::match(uni_id, grm_id, kp);
-            (_A[pos])=eigenMatrix::Zero(_n, _n);
-			
-			#pragma omp parallel for private(j)
-            for(j=0; j<_n; j++){
-                for(k=0; k<=j; k++){
-                    if(kp[j]>=kp[k]) (_A[pos])(k,j)=(_A[pos])(j,k)=_grm(kp[j],kp[k]);
-                    else (_A[pos])(k,j)=(_A[pos])(j,k)=_grm(kp[k],kp[j]);
-                }
-            }
+            (_A[pos]).resize(_n, _n);
+            _grm.fill(kp, (_A[pos]).data());
             
             if(_reml_diag_one){
                 double diag_mean=(_A[pos]).diagonal().mean();
@@ -312,8 +301,8 @@ void gcta::fit_reml(string grm_file, string phen_file, string qcovar_file, strin
             prev_file=grm_files[i];
             prev_grm_id=grm_id;
         }
-        _grm_N.resize(0,0);
-        _grm.resize(0,0);
+        _grm_N.clear();
+        _grm.clear();
     }
     _A[_r_indx.size()-1]=eigenMatrix::Identity(_n, _n);
     
@@ -394,6 +383,13 @@ void gcta::fit_reml(string grm_file, string phen_file, string qcovar_file, strin
     // bending
     if(reml_bending) bend_A();
     
+    // with a single GRM, its eigendecomposition is reused if saved by --make-grm-eigen, unless --reml-precision is given
+    if(grm_flag && !qGE_flag && !GE_flag && _reml_mtd!=1 && !mlmassoc && reml_precision==0) init_reml_spectral(grm_file, uni_id, reml_spectral);
+    if(reml_precision>0){
+        _reml_precision=reml_precision;
+        init_reml_float();
+    }
+
     // run REML algorithm
 	reml(pred_rand_eff, est_fix_eff, reml_priors, reml_priors_var, prevalence, -2.0, no_constrain, no_lrt, mlmassoc);
 }
@@ -629,8 +625,16 @@ void gcta::reml(bool pred_rand_eff, bool est_fix_eff, vector<double> &reml_prior
     eigenMatrix u;
     if(pred_rand_eff){
         u.resize(_n, _r_indx.size());
+        eigenVector Ut_Py;
+        eigenMatrix mbuf;
+        if(_reml_spectral) Ut_Py=_spec_evec.transpose()*Py;
         for(i=0; i<_r_indx.size(); i++){
-            if(_bivar_reml)(u.col(i))=(((_Asp[_r_indx[i]])*Py)*varcmp[i]);
+            if(_bivar_reml || _reml_sparse)(u.col(i))=(((_Asp[_r_indx[i]])*Py)*varcmp[i]);
+            else if(_reml_spectral) (u.col(i))=(_spec_evec*(_spec_diag[_r_indx[i]].cwiseProduct(Ut_Py)))*varcmp[i];
+            else if(_reml_precision>0){
+                calcu_Av_float(_r_indx[i], Py, mbuf);
+                (u.col(i))=mbuf.col(0)*varcmp[i];
+            }
             else (u.col(i))=(((_A[_r_indx[i]])*Py)*varcmp[i]);
         }
     }
@@ -888,15 +892,33 @@ double gcta::reml_iteration(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, eigenMatr
             for(i=0; i<_r_indx.size(); i++) cout<<_var_name[_r_indx[i]]<<"\t";
             cout<<endl;
         }
-        if(_bivar_reml) calcu_Vi_bivar(_Vi, prev_varcmp, logdet, iter); // Calculate Vi, bivariate analysis
+        if(_reml_sparse){
+            // V is factorised but neither V^-1 nor P is formed
+            calcu_Vi_sparse(prev_varcmp, logdet);
+            logdet_Xt_Vi_X=calcu_P_sparse(Vi_X, Xt_Vi_X_i);
+            ai_reml_sparse(Vi_X, Xt_Vi_X_i, Hi, Py, prev_varcmp, varcmp, dlogL, _reml_mtd==2);
+        }
+        else if(_reml_spectral){
+            // V, P and the GRM are diagonal after y and X have been rotated
+            logdet_Xt_Vi_X=ai_reml_spectral(Vi_X, Xt_Vi_X_i, Hi, Py, prev_varcmp, varcmp, logdet, dlogL, _reml_mtd==2);
+        }
+        else if(_reml_precision>0){
+            // V^-1 is calculated in single precision but P is not formed
+            calcu_Vi_float(prev_varcmp, logdet);
+            logdet_Xt_Vi_X=calcu_P_float(prev_varcmp, Vi_X, Xt_Vi_X_i);
+            ai_reml_float(Vi_X, Xt_Vi_X_i, Hi, Py, prev_varcmp, varcmp, dlogL, _reml_mtd==2);
+        }
         else{
-            if(!calcu_Vi(_Vi, prev_varcmp, logdet, iter)) continue; // Calculate Vi
+            if(_bivar_reml) calcu_Vi_bivar(_Vi, prev_varcmp, logdet, iter); // Calculate Vi, bivariate analysis
+            else{
+                if(!calcu_Vi(_Vi, prev_varcmp, logdet, iter)) continue; // Calculate Vi
+            }
+            logdet_Xt_Vi_X=calcu_P(_Vi, Vi_X, Xt_Vi_X_i, _P); // Calculate P
+            if(_reml_mtd==0) ai_reml(_P, Hi, Py, prev_varcmp, varcmp, dlogL);
+            else if(_reml_mtd==1) reml_equation(_P, Hi, Py, varcmp);
+            else if(_reml_mtd==2) em_reml(_P, Py, prev_varcmp, varcmp);
         }
-		logdet_Xt_Vi_X=calcu_P(_Vi, Vi_X, Xt_Vi_X_i, _P); // Calculate P
-		if(_reml_mtd==0) ai_reml(_P, Hi, Py, prev_varcmp, varcmp, dlogL);
-		else if(_reml_mtd==1) reml_equation(_P, Hi, Py, varcmp);
-		else if(_reml_mtd==2) em_reml(_P, Py, prev_varcmp, varcmp);
-		lgL=-0.5*(logdet_Xt_Vi_X+logdet+(_y.transpose()*Py)(0,0));
+		lgL=-0.5*(logdet_Xt_Vi_X+logdet+((_reml_spectral?_spec_y:_y).transpose()*Py)(0,0));
         
         // output log
         if(!no_constrain) constrain_num=constrain_varcmp(varcmp);
@@ -917,7 +939,9 @@ double gcta::reml_iteration(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, eigenMatr
 		// convergence
 		dlogL=lgL-prev_lgL;
 		if((varcmp-prev_varcmp).squaredNorm()/varcmp.squaredNorm()<1e-8 && (fabs(dlogL)<1e-4 || (fabs(dlogL)<1e-2 && dlogL<0))){
-			if(_reml_mtd==2){ calcu_Hi(_P, Hi); Hi=2*Hi; } // for calculation of SE
+			if(_reml_mtd==2 && _reml_spectral){ calcu_Hi_spectral(Vi_X, Xt_Vi_X_i, prev_varcmp, Hi); Hi=2*Hi; }
+			else if(_reml_mtd==2 && !_reml_sparse && _reml_precision==0){ calcu_Hi(_P, Hi); Hi=2*Hi; } // for calculation of SE
+			else if(_reml_mtd==2 && _reml_precision>0){ calcu_Hi_float(Vi_X, Xt_Vi_X_i, Hi); Hi=2*Hi; }
             break;
 		}
         prev_varcmp=varcmp;
@@ -929,6 +953,10 @@ double gcta::reml_iteration(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, eigenMatr
         if(_reml_max_iter>1) throw(errmsg.str());
     }
 	else cout<<"Log-likelihood ratio converged."<<endl;
+    if(_reml_spectral){
+        Py=_spec_evec*Py;
+        Vi_X=_spec_evec*Vi_X;
+    }
     
 	return lgL;
 }
@@ -1134,29 +1162,31 @@ double gcta::calcu_P(eigenMatrix &Vi, eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i,
 	return logdet_Xt_Vi_X;
 }
 
-// input P, calculate PA and Hi
+// input P, calculate Hi from tr(PA_iPA_j)=sum(PA_iP .* A_j); the lower triangle of PA_iP is formed for one component at a time
 void gcta::calcu_Hi(eigenMatrix &P, eigenMatrix &Hi)
 {
-    int i=0, j=0, k=0, l=0;
-    double d_buf=0.0;
-    
-	// Calculate PA
-    vector<eigenMatrix> PA(_r_indx.size());
-	for(i=0; i<_r_indx.size(); i++){
-	    (PA[i]).resize(_n, _n);
-	    if(_bivar_reml) (PA[i])=P*(_Asp[_r_indx[i]]);
-        else (PA[i])=P*(_A[_r_indx[i]]);
-	}
+    if(_bivar_reml) calcu_Hi(P, _Asp, Hi);
+    else calcu_Hi(P, _A, Hi);
+}
+
+// P and A in double (or single) precision, or A sparse in the bivariate analysis
+template<typename MatType, typename GrmType>
+void gcta::calcu_Hi(const MatType &P, const vector<GrmType> &A, eigenMatrix &Hi)
+{
+    int i=0, j=0, e=-1;
+    MatType PA, PAP(_n, _n);
     
-	// Calculate Hi
+    // the residual component (A=I) needs no matrix product: tr(PA_iPI)=tr(PA_iP), tr(PIPI)=sum(P .* P)
+    if(!_bivar_reml && _r_indx[_r_indx.size()-1]==_A.size()-1) e=_r_indx.size()-1;
 	for(i=0; i<_r_indx.size(); i++){
-		for(j=0; j<=i; j++){
-			d_buf=0.0;
-			for(k=0; k<_n; k++){
-				for(l=0; l<_n; l++) d_buf+=(PA[i])(k,l)*(PA[j])(l,k);
-			}
-			Hi(i,j)=Hi(j,i)=d_buf;
-		}
+        if(i==e){
+            Hi(i,i)=trace_prod(P, P);
+            continue;
+        }
+        PA.noalias()=P*(A[_r_indx[i]]);
+        PAP.template triangularView<Lower>()=PA*P;
+		for(j=0; j<=i; j++) Hi(i,j)=Hi(j,i)=trace_prod(PAP, A[_r_indx[j]]);
+        if(e>-1) Hi(i,e)=Hi(e,i)=PAP.diagonal().template cast<double>().sum();
 	}
     
     if(!inverse_H(Hi)) throw("Error: the information matrix is not invertible.");
@@ -1190,29 +1220,36 @@ void gcta::reml_equation(eigenMatrix &P, eigenMatrix &Hi, eigenVector &Py, eigen
 // input P, calculate PA, H, R and varcmp
 void gcta::ai_reml(eigenMatrix &P, eigenMatrix &Hi, eigenVector &Py, eigenVector &prev_varcmp, eigenVector &varcmp, double dlogL)
 {
-    int i=0, j=0;
+    int i=0;
     
  	Py=P*_y;
-	eigenVector cvec(_n);
 	eigenMatrix APy(_n, _r_indx.size());
 	for(i=0; i<_r_indx.size(); i++){
         if(_bivar_reml) (APy.col(i))=(_Asp[_r_indx[i]])*Py;
         else (APy.col(i))=(_A[_r_indx[i]])*Py;
     }
-    
-	// Calculate Hi
-	eigenVector R(_r_indx.size());
-	for(i=0; i<_r_indx.size(); i++){
-		R(i)=(Py.transpose()*(APy.col(i)))(0,0);
-		cvec=P*(APy.col(i));
-		Hi(i,i)=((APy.col(i)).transpose()*cvec)(0,0);
-		for(j=0; j<i; j++) Hi(j,i)=Hi(i,j)=((APy.col(j)).transpose()*cvec)(0,0);
-	}
-	Hi=0.5*Hi;
-    
-	// Calcualte tr(PA) and dL
+	eigenMatrix PAPy=P*APy;
     eigenVector tr_PA;
 	calcu_tr_PA(P, tr_PA);
+    ai_reml_update(Py, APy, PAPy, tr_PA, Hi, prev_varcmp, varcmp, dlogL, false);
+}
+
+// AI-REML (or EM-REML if em_flag) update of the variance components from A_i Py, P A_i Py and tr(P A_i),
+// shared by the dense, sparse, spectral and single precision analyses; Hi is the inverse of the AI matrix, and neither
+// Hi nor PAPy is used with EM-REML
+void gcta::ai_reml_update(const eigenVector &Py, const eigenMatrix &APy, const eigenMatrix &PAPy, const eigenVector &tr_PA, eigenMatrix &Hi, eigenVector &prev_varcmp, eigenVector &varcmp, double dlogL, bool em_flag)
+{
+    int i=0;
+	eigenVector R=APy.transpose()*Py;
+    
+	// the EM update needs neither the AI matrix nor its inverse, as em_reml
+    if(em_flag){
+        for(i=0; i<_r_indx.size(); i++) varcmp(i)=(prev_varcmp(i)*_n-prev_varcmp(i)*prev_varcmp(i)*tr_PA(i)+prev_varcmp(i)*prev_varcmp(i)*R(i))/_n;
+        return;
+    }
+    
+	// Calculate Hi and dL
+	Hi=0.5*(APy.transpose()*PAPy);
 	R=-0.5*(tr_PA-R);
     
 	// Calculate variance component
@@ -1251,23 +1288,45 @@ void gcta::em_reml(eigenMatrix &P, eigenVector &Py, eigenVector &prev_varcmp, ei
 // input P, calculate tr(PA)
 void gcta::calcu_tr_PA(eigenMatrix &P, eigenVector &tr_PA)
 {
-	int i=0, k=0, l=0;
-    double d_buf=0.0;
-    
-	// Calculate trace(PA)
 	tr_PA.resize(_r_indx.size());
-	for(i=0; i<_r_indx.size(); i++){
-        if(_bivar_reml)  tr_PA(i)=(P*(_Asp[_r_indx[i]])).diagonal().sum();
-        else{
-            d_buf=0.0;
-            for(k=0; k<_n; k++){
-                for(l=0; l<_n; l++) d_buf+=P(k,l)*(_A[_r_indx[i]])(k,l);
-            }
-            tr_PA(i)=d_buf;            
-        }
+	for(int i=0; i<_r_indx.size(); i++){
+        if(_bivar_reml) tr_PA(i)=trace_prod(P, _Asp[_r_indx[i]]);
+        else tr_PA(i)=trace_prod(P, _A[_r_indx[i]]);
 	}
 }
 
+// tr(AB) for symmetric A and B, using the lower triangle of A only; the elements are converted to double
+// so that the products are accumulated in double precision for the matrices in single precision
+template<typename MatType>
+double gcta::trace_prod(const MatType &A, const MatType &B)
+{
+    int j=0, n=A.cols();
+    double d_buf=0.0;
+    #pragma omp parallel for reduction(+:d_buf) schedule(dynamic, 64)
+    for(j=0; j<n; j++) d_buf+=2.0*A.col(j).tail(n-j).template cast<double>().dot(B.col(j).tail(n-j).template cast<double>())-(double)A(j,j)*B(j,j);
+    return d_buf;
+}
+
+template double gcta::trace_prod(const MatrixXf &A, const MatrixXf &B);
+template double gcta::trace_prod(const MatrixXd &A, const MatrixXd &B);
+template void gcta::calcu_Hi(const MatrixXf &P, const vector<MatrixXf> &A, eigenMatrix &Hi);
+template void gcta::calcu_Hi(const MatrixXd &P, const vector<MatrixXd> &A, eigenMatrix &Hi);
+template void gcta::calcu_Hi(const eigenMatrix &P, const vector<eigenSparseMat> &A, eigenMatrix &Hi);
+
+double gcta::trace_prod(const eigenMatrix &A, const eigenSparseMat &B)
+{
+    int j=0;
+    double d_buf=0.0;
+    #pragma omp parallel for reduction(+:d_buf)
+    for(j=0; j<B.outerSize(); j++){
+        for(eigenSparseMat::InnerIterator it(B, j); it; ++it){
+            if(it.row()>=it.col()) d_buf+=A(it.row(), it.col())*it.value();
+            else d_buf+=A(it.col(), it.row())*it.value();
+        }
+    }
+    return d_buf;
+}
+
 // blue estimate of SNP effect
 void gcta::blup_snp_geno()
 {
@@ -1288,12 +1347,14 @@ void gcta::blup_snp_geno()
         else var_SNP[j]=1.0/var_SNP[j];
 	}
 	
+	vector<unsigned char> code(_keep.size());
 	for(k=0; k<_include.size(); k++){
 	    fcount=0.0;
+        _geno.get_snp(_include[k], _keep, &code[0]);
         for(i=0; i<_keep.size(); i++){
-            if(!_snp_1[_include[k]][_keep[i]] || _snp_2[_include[k]][_keep[i]]){
-                if(_allele1[_include[k]]==_ref_A[_include[k]]) x=_snp_1[_include[k]][_keep[i]]+_snp_2[_include[k]][_keep[i]];
-                else x=2.0-(_snp_1[_include[k]][_keep[i]]+_snp_2[_include[k]][_keep[i]]);
+            if(!GenoStore::miss(code[i])){
+                if(_allele1[_include[k]]==_ref_A[_include[k]]) x=GenoStore::dose(code[i]);
+                else x=2.0-GenoStore::dose(code[i]);
                 x=(x-_mu[_include[k]]);
                 for(j=0; j<col_num; j++) b_SNP(k,j)+=x*_varcmp_Py(i,j);
                 fcount+=1.0;
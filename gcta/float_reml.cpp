@@ -0,0 +1,151 @@
+/*
+ * GCTA: a tool for Genome-wide Complex Trait Analysis
+ *
+ * Implementations of functions for REML analysis in single or mixed precision
+ *
+ * The GRMs and V^-1 are stored, and V is factorised and inverted, in single
+ * precision, which halves the memory and about doubles the speed of the
+ * matrix operations. P is not formed: Pv and tr(PA) are calculated from
+ * V^-1, V^-1 X and (X^t V^-1 X)^-1 by single-precision matrix products, and
+ * the logL, the AI matrix and the updates are accumulated in double precision.
+ * With the mixed precision, the products with the GRMs are accumulated in
+ * double and the solutions V^-1 v (Py, V^-1 X and P A Py) are refined
+ * iteratively against V in double precision; tr(V^-1 A) is not refined.
+ * In single precision, the solutions are not refined: only V^-1 y is
+ * checked, by its residual ||y-Vx||/||y|| in double precision at each
+ * iteration, and the analysis stops if it exceeds 1e-3.
+ *
+ * This file is distributed under the GNU General Public
+ * License, Version 2.  Please see the file COPYING for more
+ * details
+ */
+
+#include "gcta.h"
+
+void gcta::init_reml_float()
+{
+    int i=0, e=_A.size()-1;
+    cout<<"The GRMs and V^-1 are stored in single precision"<<(_reml_precision==2?" and the solutions with V are refined in double precision":"")<<"."<<endl;
+    _Af.resize(_A.size());
+    for(i=0; i<e; i++){
+        _Af[i]=(_A[i]).cast<float>();
+        (_A[i]).resize(0,0);
+    }
+    (_A[e]).resize(0,0);
+}
+
+// A_k v with A_k in single precision (SGEMM); with the mixed precision or dbl_flag, blocks of columns of A_k are
+// converted to double so that the products, in particular the residuals, are accumulated in double (DGEMM).
+// A_k is the identity matrix for the residual
+void gcta::calcu_Av_float(int k, const eigenMatrix &v, eigenMatrix &Av, bool dbl_flag)
+{
+    int j=0, b=0, blk=256;
+    if(k==_A.size()-1){
+        Av=v;
+        return;
+    }
+    if(_reml_precision!=2 && !dbl_flag){
+        MatrixXf v_f=v.cast<float>(), Av_f=(_Af[k])*v_f;
+        Av=Av_f.cast<eigenMatrix::Scalar>();
+        return;
+    }
+    eigenMatrix A_blk;
+    Av.setZero(_n, v.cols());
+    for(j=0; j<_n; j+=blk){
+        b=min(blk, _n-j);
+        A_blk=(_Af[k]).middleCols(j, b).cast<eigenMatrix::Scalar>();
+        Av.noalias()+=A_blk*v.middleRows(j, b);
+    }
+}
+
+// V^-1 v by V^-1 in single precision; with the mixed precision, x=V^-1 v is refined by x+=V^-1(v-Vx),
+// Vx in double precision, until the residual stops decreasing. In single precision, x is not refined and
+// ||v-Vx||/||v|| is only checked if chk_flag
+void gcta::calcu_Vi_v_float(eigenVector &varcmp, const eigenMatrix &v, eigenMatrix &Vi_v, bool chk_flag)
+{
+    int i=0, iter=0;
+    double v_norm=v.norm(), r_norm=0.0, prev_r_norm=0.0;
+    eigenMatrix r, Av;
+    MatrixXf v_f=v.cast<float>();
+
+    Vi_v=(_Vi_f*v_f).cast<eigenMatrix::Scalar>();
+    if(_reml_precision!=2 && !chk_flag) return;
+    for(iter=0; iter<20; iter++){
+        r=v;
+        for(i=0; i<_r_indx.size(); i++){
+            calcu_Av_float(_r_indx[i], Vi_v, Av, true);
+            r-=Av*varcmp[i];
+        }
+        r_norm=r.norm();
+        if(_reml_precision!=2){
+            if(r_norm>1e-3*v_norm) throw("Error: V^-1 in single precision is not accurate enough because V is ill-conditioned. Please try the option --reml-precision mixed or double.");
+            return;
+        }
+        if(r_norm<=1e-12*v_norm || (iter>0 && r_norm>0.5*prev_r_norm)) break;
+        prev_r_norm=r_norm;
+        v_f=r.cast<float>();
+        Vi_v+=(_Vi_f*v_f).cast<eigenMatrix::Scalar>();
+    }
+    if(r_norm>1e-6*v_norm) throw("Error: the iterative refinement in mixed precision does not converge because V is ill-conditioned. Please try the option --reml-precision double.");
+}
+
+void gcta::calcu_Vi_float(eigenVector &prev_varcmp, double &logdet)
+{
+    int i=0;
+    _Vi_f.setZero(_n, _n);
+    for(i=0; i<_r_indx.size(); i++){
+        if(_r_indx[i]==_A.size()-1) _Vi_f.diagonal().array()+=(float)prev_varcmp[i];
+        else _Vi_f+=(_Af[_r_indx[i]])*(float)prev_varcmp[i];
+    }
+    if(_V_inv_mtd==0 && !comput_inverse_logdet_LDLT_mkl(_Vi_f, logdet)) _V_inv_mtd=1;
+    if(_V_inv_mtd==1 && !comput_inverse_logdet_LU_mkl(_Vi_f, logdet)) throw("Error: the variance-covaraince matrix V is not invertible in single precision. Please try the option --reml-precision double.");
+}
+
+double gcta::calcu_P_float(eigenVector &prev_varcmp, eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i)
+{
+    calcu_Vi_v_float(prev_varcmp, _X, Vi_X);
+	Xt_Vi_X_i=_X.transpose()*Vi_X;
+	return comput_inverse_logdet_LU(Xt_Vi_X_i, "\nError: the X^t * V^-1 * X matrix is not invertible. Please check the covariate(s) and/or the environmental factor(s).");
+}
+
+// Pv = V^-1 v - V^-1 X (X^t V^-1 X)^-1 X^t V^-1 v
+void gcta::calcu_Pv_float(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, eigenVector &prev_varcmp, const eigenMatrix &v, eigenMatrix &Pv, bool chk_flag)
+{
+    calcu_Vi_v_float(prev_varcmp, v, Pv, chk_flag);
+    Pv-=Vi_X*(Xt_Vi_X_i*(_X.transpose()*Pv));
+}
+
+// inverse of the information matrix tr(P A_i P A_j) at convergence of EM-REML; P is formed in place of V^-1
+void gcta::calcu_Hi_float(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, eigenMatrix &Hi)
+{
+    MatrixXf mbuf=(Vi_X*Xt_Vi_X_i).cast<float>();
+    _Vi_f.noalias()-=mbuf*Vi_X.transpose().cast<float>();
+    calcu_Hi(_Vi_f, _Af, Hi);
+}
+
+// AI-REML (or EM-REML if em_flag) with V^-1 in single precision; Hi is the inverse of the AI matrix with AI-REML
+// and calculated by calcu_Hi_float at convergence of EM-REML
+void gcta::ai_reml_float(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, eigenMatrix &Hi, eigenVector &Py, eigenVector &prev_varcmp, eigenVector &varcmp, double dlogL, bool em_flag)
+{
+    int i=0, k=0;
+    eigenMatrix mbuf, APy(_n, _r_indx.size()), PAPy;
+
+    calcu_Pv_float(Vi_X, Xt_Vi_X_i, prev_varcmp, _y, mbuf, true);
+    Py=mbuf.col(0);
+	for(i=0; i<_r_indx.size(); i++){
+        calcu_Av_float(_r_indx[i], Py, mbuf);
+        APy.col(i)=mbuf.col(0);
+    }
+    if(!em_flag) calcu_Pv_float(Vi_X, Xt_Vi_X_i, prev_varcmp, APy, PAPy);
+
+	// Calcualte tr(PA) = tr(V^-1 A) - tr((X^t V^-1 X)^-1 X^t V^-1 A V^-1 X)
+    eigenVector tr_PA(_r_indx.size());
+	for(i=0; i<_r_indx.size(); i++){
+        k=_r_indx[i];
+        if(k==_A.size()-1) tr_PA(i)=_Vi_f.diagonal().cast<double>().sum();
+        else tr_PA(i)=trace_prod(_Vi_f, _Af[k]);
+        calcu_Av_float(k, Vi_X, mbuf);
+        tr_PA(i)-=(Xt_Vi_X_i*(Vi_X.transpose()*mbuf)).trace();
+	}
+    ai_reml_update(Py, APy, PAPy, tr_PA, Hi, prev_varcmp, varcmp, dlogL, em_flag);
+}
@@ -24,6 +24,10 @@
 #include "CommFunc.h"
 #include "StrFunc.h"
 #include "StatFunc.h"
+#include "GenoStore.h"
+#include "GrmStore.h"
+#include "GrmCbin.h"
+#include "BedFile.h"
 #include <fstream>
 #include <iomanip>
 #include <bitset>
@@ -70,6 +74,7 @@ public:
     void update_ref_A(string ref_A_file);
     void update_impRsq(string zinfofile);
     void update_freq(string freq);
+    void read_pc_loading(string pcl_file);
 	void save_freq(bool ssq_flag);
     void extract_snp(string snplistfile);
     void extract_single_snp(string snpname);
@@ -86,10 +91,16 @@ public:
 	void save_XMat(bool miss_with_mu);
 
     void save_grm(string grm_file, string keep_indi_file, string remove_indi_file, string sex_file, double grm_cutoff, double adj_grm_fac, int dosage_compen, bool merge_grm_flag, bool output_grm_bin);
-    void pca(string grm_file, string keep_indi_file, string remove_indi_file, double grm_cutoff, bool merge_grm_flag, int out_pc_num);
+    void pca(string grm_file, string keep_indi_file, string remove_indi_file, double grm_cutoff, bool merge_grm_flag, int out_pc_num, bool approx_flag=false, double approx_tol=1e-5);
 
     void enable_grm_bin_flag();
-	void fit_reml(string grm_file, string phen_file, string qcovar_file, string covar_file, string qGE_file, string GE_file, string keep_indi_file, string remove_indi_file, string sex_file, int mphen, double grm_cutoff, double adj_grm_fac, int dosage_compen, bool m_grm_flag, bool pred_rand_eff, bool est_fix_eff, int reml_mtd, int MaxIter, vector<double> reml_priors, vector<double> reml_priors_var, vector<int> drop, bool no_lrt, double prevalence, bool no_constrain, bool mlmassoc=false, bool within_family=false, bool reml_bending=false, bool reml_diag_one=false);
+    void enable_geno_stream(int block_size);
+    void enable_grm_part(int part_num, int part);
+    void enable_grm_cbin_flag();
+    void enable_grm_cbin_output(int type);
+    void merge_grm_part(string grm_file, int part_num);
+	void fit_reml(string grm_file, string phen_file, string qcovar_file, string covar_file, string qGE_file, string GE_file, string keep_indi_file, string remove_indi_file, string sex_file, int mphen, double grm_cutoff, double adj_grm_fac, int dosage_compen, bool m_grm_flag, bool pred_rand_eff, bool est_fix_eff, int reml_mtd, int MaxIter, vector<double> reml_priors, vector<double> reml_priors_var, vector<int> drop, bool no_lrt, double prevalence, bool no_constrain, bool mlmassoc=false, bool within_family=false, bool reml_bending=false, bool reml_diag_one=false, bool reml_spectral=false, int reml_precision=0);
+    void fit_reml_sparse(string grm_file, string phen_file, string qcovar_file, string covar_file, string keep_indi_file, string remove_indi_file, int mphen, bool m_grm_flag, bool pred_rand_eff, bool est_fix_eff, int MaxIter, vector<double> reml_priors, vector<double> reml_priors_var, vector<int> drop, bool no_lrt, double prevalence, bool no_constrain);
     void HE_reg(string grm_file, string phen_file, string keep_indi_file, string remove_indi_file, int mphen);
 	void blup_snp_geno();
 	void blup_snp_dosage();
@@ -121,6 +132,11 @@ public:
 	
 	// mkl
     void make_grm_mkl(bool grm_xchr_flag, bool inbred, bool output_bin, int grm_mtd, bool mlmassoc, bool diag_f3_flag=false);
+    void make_grm_sparse(bool grm_xchr_flag, bool inbred, int grm_mtd, bool diag_f3_flag, double sp_cutoff);
+    void save_grm_eigen(string grm_file, string keep_indi_file, string remove_indi_file, double grm_cutoff, bool merge_grm_flag);
+    void pca_geno(int out_pc_num, double tol, bool loading_flag);
+    void project_pca();
+    void make_mgrm(bool inbred, bool output_bin, int grm_mtd, bool diag_f3_flag, bool chr_flag, vector<double> maf_bin, string snp_grp_file);
     
     // mlma
     void mlma(string grm_file, string phen_file, string qcovar_file, string covar_file, int mphen, int MaxIter, vector<double> reml_priors, vector<double> reml_priors_var, bool no_constrain, bool inbred, bool no_adj_covar);
@@ -149,7 +165,9 @@ private:
     void std_XMat(vector< vector<float> > &X, vector<double> &sd_SNP, bool grm_xchr_flag, bool divid_by_std=true);
     void makex_eigenVector(int j, eigenVector &x, bool resize=true, bool minus_2p=false);
 
+    void load_geno_block(int j_start, int j_end);
     void calcu_mu(bool ssq_flag=false);
+    void calcu_mu_block(int j_start, int j_end);
     void mu_func(int j, vector<double> &fac);
 	void rm_high_ld();
     void check_autosome();
@@ -161,12 +179,19 @@ private:
     void read_grm(string grm_file, vector<string> &grm_id, bool out_id_log=true, bool read_id_only=false);
 	void read_grm_gz(string grm_file, vector<string> &grm_id, bool out_id_log=true, bool read_id_only=false);
     void read_grm_bin(string grm_file, vector<string> &grm_id, bool out_id_log=true, bool read_id_only=false);
+    void read_grm_cbin(string grm_file, vector<string> &grm_id, bool out_id_log=true, bool read_id_only=false);
+    void load_grm_N();
     void read_grm_filenames(string merge_grm_file, vector<string> &grm_files, bool out_log=true);
     void merge_grm(string merge_grm_file);
+    void merge_grm_stream(string merge_grm_file, string keep_indi_file, string remove_indi_file, bool output_grm_bin);
+    void unpack_grm_cbin(string grm_file, unsigned long n, string file);
+    void eigen_approx(int n, int k, double tol, void (gcta::*mult)(const MatrixXd &, MatrixXd &), VectorXd &eval, MatrixXd &evec);
+    void output_pca(const VectorXd &eval, const MatrixXd &evec, int out_pc_num, bool all_eval);
+    template<typename VecType, typename MatType> bool read_grm_eigen(string grm_file, const vector<string> &id, uint64_t digest, VecType &eval, MatType &evec, bool descend_flag=false);
     void rm_cor_indi(double grm_cutoff);
     void adj_grm(double adj_grm_fac);
     void dc(int dosage_compen);
-    void manipulate_grm(string grm_file, string keep_indi_file, string remove_indi_file, string sex_file, double grm_cutoff, double adj_grm_fac, int dosage_compen, bool merge_grm_flag);
+    void manipulate_grm(string grm_file, string keep_indi_file, string remove_indi_file, string sex_file, double grm_cutoff, double adj_grm_fac, int dosage_compen, bool merge_grm_flag, bool grm_N_flag=true);
     void output_grm_vec(vector< vector<float> > &A, vector< vector<int> > &A_N, bool output_grm_bin);
     void output_grm_MatrixXf(bool output_grm_bin);
 
@@ -193,15 +218,44 @@ private:
 	double comput_inverse_logdet_LU(eigenMatrix &Vi, string errmsg);
     double calcu_P(eigenMatrix &Vi, eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, eigenMatrix &P);
 	void calcu_Hi(eigenMatrix &P, eigenMatrix &Hi);
+    template<typename MatType, typename GrmType> void calcu_Hi(const MatType &P, const vector<GrmType> &A, eigenMatrix &Hi);
 	void reml_equation(eigenMatrix &P, eigenMatrix &Hi, eigenVector &Py, eigenVector &varcmp);
 	double lgL_reduce_mdl(bool no_constrain);
     void em_reml(eigenMatrix &P, eigenVector &Py, eigenVector &prev_varcmp, eigenVector &varcmp);
 	void ai_reml(eigenMatrix &P, eigenMatrix &Hi, eigenVector &Py, eigenVector &prev_varcmp, eigenVector &varcmp, double dlogL);
+    void ai_reml_update(const eigenVector &Py, const eigenMatrix &APy, const eigenMatrix &PAPy, const eigenVector &tr_PA, eigenMatrix &Hi, eigenVector &prev_varcmp, eigenVector &varcmp, double dlogL, bool em_flag);
 	void calcu_tr_PA(eigenMatrix &P, eigenVector &tr_PA);
+    template<typename MatType> double trace_prod(const MatType &A, const MatType &B);
+    double trace_prod(const eigenMatrix &A, const eigenSparseMat &B);
     void calcu_Vp(double &Vp, double &Vp2, double &VarVp, double &VarVp2, eigenVector &varcmp, eigenMatrix &Hi);
 	void calcu_hsq(int i, double Vp, double Vp2, double VarVp, double VarVp2, double &hsq, double &var_hsq, eigenVector &varcmp, eigenMatrix &Hi);
 	void output_blup_snp(eigenMatrix &b_SNP);
   
+    // REML analysis with sparse GRMs
+    void read_grm_sparse(string grm_file, const vector<string> &uni_id, eigenSparseMat &A);
+    bool calcu_Vi_sparse(eigenVector &prev_varcmp, double &logdet);
+    double calcu_P_sparse(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i);
+    void calcu_Pv_sparse(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, const eigenMatrix &v, eigenMatrix &Pv);
+    void ai_reml_sparse(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, eigenMatrix &Hi, eigenVector &Py, eigenVector &prev_varcmp, eigenVector &varcmp, double dlogL, bool em_flag);
+    void calcu_tr_PA_sparse(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, eigenVector &tr_PA);
+
+    // REML analysis by the eigendecomposition of the GRM
+    bool init_reml_spectral(string grm_file, const vector<string> &id, bool decomp_flag);
+    void calcu_Vi_spectral(const vector<double> &varcmp);
+    void calcu_Pv_spectral(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, const eigenVector &w, const eigenMatrix &v, eigenMatrix &Pv);
+    double ai_reml_spectral(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, eigenMatrix &Hi, eigenVector &Py, eigenVector &prev_varcmp, eigenVector &varcmp, double &logdet, double dlogL, bool em_flag);
+    void calcu_Hi_spectral(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, eigenVector &prev_varcmp, eigenMatrix &Hi);
+
+    // REML analysis in single or mixed precision
+    void init_reml_float();
+    void calcu_Av_float(int k, const eigenMatrix &v, eigenMatrix &Av, bool dbl_flag=false);
+    void calcu_Vi_v_float(eigenVector &varcmp, const eigenMatrix &v, eigenMatrix &Vi_v, bool chk_flag=false);
+    void calcu_Vi_float(eigenVector &prev_varcmp, double &logdet);
+    double calcu_P_float(eigenVector &prev_varcmp, eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i);
+    void calcu_Pv_float(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, eigenVector &prev_varcmp, const eigenMatrix &v, eigenMatrix &Pv, bool chk_flag=false);
+    void calcu_Hi_float(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, eigenMatrix &Hi);
+    void ai_reml_float(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, eigenMatrix &Hi, eigenVector &Py, eigenVector &prev_varcmp, eigenVector &varcmp, double dlogL, bool em_flag);
+
     // bivariate REML analysis
     void calcu_rg(eigenVector &varcmp, eigenMatrix &Hi, eigenVector &rg, eigenVector &rg_var, vector<string> &rg_name);
     void update_A(eigenVector &prev_varcmp);
@@ -248,11 +302,23 @@ private:
 
 	// mkl 
 	void make_XMat_mkl(float* X);
+    void make_grm_stream(bool grm_xchr_flag, bool inbred, bool output_bin, int grm_mtd, bool diag_f3_flag, const vector<int> &snp_grp, const vector<string> &grp_name);
+    void make_grm_int(bool grm_xchr_flag, bool inbred, bool output_bin);
+    void grm_part_range(unsigned long n, unsigned long &r_start, unsigned long &r_end, bool out_log=true);
+    void count_miss_pair(const uint64_t *miss_bits, unsigned long word_num, const vector<int> &miss_indi, unsigned long r_start, unsigned long r_end, vector<float> &A_N);
+    void grm_mult(const MatrixXd &Q, MatrixXd &Y);
+    void geno_mult(const MatrixXd &Q, MatrixXd &Y);
+    void syrk_packed(const float *X, const vector<unsigned long> &c_pos, unsigned long r_start, unsigned long r_end, float *A, bool add);
     void std_XMat_mkl(float* X, vector<double> &sd_SNP, bool grm_xchr_flag, bool miss_with_mu=false, bool divid_by_std=true);
-	void output_grm_mkl(float* A, vector< vector<float> > &A_N, bool output_grm_bin);
-	bool comput_inverse_logdet_LDLT_mkl(eigenMatrix &Vi, double &logdet);
-    bool comput_inverse_logdet_LU_mkl(eigenMatrix &Vi, double &logdet);
+    void std_snp_mkl(unsigned long j, float *x, unsigned long num, unsigned long inc, double sd, bool grm_xchr_flag, bool miss_with_mu, bool divid_by_std);
+    void std_geno_block(unsigned long j_start, unsigned long j_end, float *X);
+	void output_grm_mkl(float* A, vector<float> &A_N, bool output_grm_bin, string grp_name="");
+    bool eigen_sym_mkl(eigenMatrix &A, eigenVector &eval);
+    template<typename MatType> bool comput_inverse_logdet_LDLT_mkl(MatType &Vi, double &logdet);
+    template<typename MatType> bool comput_inverse_logdet_LU_mkl(MatType &Vi, double &logdet);
     bool comput_inverse_logdet_LU_mkl_array(int n, float *Vi, double &logdet);
+    VectorXd &V_inv_work(double) {return _V_inv_work;}
+    VectorXf &V_inv_work(float) {return _V_inv_work_f;}
     
     // mlma
     void mlma_calcu_stat(float *y, float *geno_mkl, unsigned long n, unsigned long m, eigenVector &beta, eigenVector &se, eigenVector &pval);
@@ -263,15 +329,54 @@ private:
     void makex(int j, vector<ElemType> &x, bool minus_2p=false)
     {
         int i=0;
+        ElemType val[4];
         x.resize(_keep.size());
-        for(i=0; i<_keep.size(); i++){
-            if(!_snp_1[_include[j]][_keep[i]] || _snp_2[_include[j]][_keep[i]]){
-                if(_allele1[_include[j]]==_ref_A[_include[j]]) x[i]=(_snp_1[_include[j]][_keep[i]]+_snp_2[_include[j]][_keep[i]]);
-                else x[i]=2.0-(_snp_1[_include[j]][_keep[i]]+_snp_2[_include[j]][_keep[i]]);
+        geno_val(j, val, _mu[_include[j]]);
+        if(minus_2p){
+            for(i=0; i<4; i++) val[i]-=_mu[_include[j]];
+        }
+        _geno.get_snp(geno_snp(j), geno_keep(), val, &x[0]);
+    }
+
+    // the j-th included SNP and the individuals in _keep in _geno: when the genotypes are streamed, _geno only holds
+    // the SNPs of the current block (load_geno_block) and the individuals in _keep, at their positions in _keep
+    int geno_snp(int j) const {return _geno_block>0?j:_include[j];}
+    const vector<int> &geno_keep() const {return _geno_block>0?_geno_kp:_keep;}
+
+    // value of each genotype code of the j-th included SNP: dosage of the reference allele, or miss_val if missing
+    template<typename ElemType>
+    void geno_val(int j, ElemType val[4], double miss_val)
+    {
+        if(_allele1[_include[j]]==_ref_A[_include[j]]){ val[0]=2.0; val[2]=1.0; val[3]=0.0; }
+        else{ val[0]=0.0; val[2]=1.0; val[3]=2.0; }
+        val[1]=miss_val;
+    }
+
+    // digest of the IDs and of the lower triangle (in single precision) of a GRM, to match it with a .grm.eigen file
+    template<typename MatType>
+    uint64_t grm_digest(const MatType &A, const vector<string> &id)
+    {
+        unsigned long i=0, j=0, k=0, n=id.size();
+        uint64_t h=14695981039346656037ULL;
+        for(i=0; i<n; i++){
+            for(k=0; k<id[i].size(); k++) h=(h^(unsigned char)id[i][k])*1099511628211ULL;
+            h=(h^'\n')*1099511628211ULL;
+        }
+        for(i=0; i<n; i++){
+            for(j=0; j<=i; j++){
+                union { float f; uint32_t w; } u;
+                u.f=(float)A(i,j);
+                h=(h^u.w)*1099511628211ULL;
             }
-            else x[i]=_mu[_include[j]];
-            if(minus_2p) x[i]-=_mu[_include[j]];
         }
+        return h;
+    }
+
+    // position of element (i,j) of a symmetric matrix stored as the lower triangle packed by row
+    static unsigned long tri_indx(unsigned long i, unsigned long j)
+    {
+        if(i<j) return j*(j+1)/2+i;
+        return i*(i+1)/2+j;
     }
 
 private:
@@ -304,8 +409,16 @@ private:
 	eigenMatrix _varcmp_Py; // BLUP solution to the total genetic effects of individuals
 
     // bed file
-    vector< vector<bool> > _snp_1;
-    vector< vector<bool> > _snp_2;
+    GenoStore _geno;
+    BedFile _bed; // kept open when the genotypes are streamed
+    vector<int> _bed_snp_pos; // position of each SNP in the BED file
+    vector<int> _bed_indi_pos; // position of each individual in the BED file, empty if all are kept
+    int _geno_block; // number of SNPs per block when the genotypes are streamed, 0 to load all of them
+    vector<int> _geno_kp; // 0 to _keep.size()-1, the individuals in _geno when the genotypes are streamed
+
+    // SNP loadings of the principal components
+    MatrixXf _pc_load;
+    vector<int> _pc_load_indx; // row of each SNP in _pc_load, -1 if not there
 
     // imputed data
     bool _dosage_flag;
@@ -313,11 +426,16 @@ private:
     vector<double> _impRsq;
 
     // grm
-    eigenMatrix _grm_N;
-    eigenMatrix _grm;
-    float * _grm_mkl;
+    GrmStore _grm_N; // read on demand by load_grm_N()
+    GrmStore _grm;
+    string _grm_N_file;
+    float * _grm_mkl; // lower triangle packed by row, element (i,j) at i*(i+1)/2+j
     float * _geno_mkl;
 	bool _grm_bin_flag;
+    int _grm_part_num; // number of parts the GRM is split into by rows, 0 for the whole GRM
+    int _grm_part;
+    bool _grm_cbin_flag;
+    int _grm_cbin_type; // element type of the GRM in the .grm.cbin output, -1 for .grm.bin or .grm.gz
 
     // reml
     int _n;
@@ -343,6 +461,19 @@ private:
     bool _reml_diag_one;
     bool _reml_have_bend_A;
     int _V_inv_mtd;
+    vector<int> _V_inv_ipiv; // pivots and workspace (one for each precision) of the LU inversion of V, kept across iterations
+    VectorXd _V_inv_work;
+    VectorXf _V_inv_work_f;
+    bool _reml_sparse;
+    SimplicialLDLT<eigenSparseMat> _V_sp_ldlt; // factor of V with sparse GRMs
+    bool _reml_spectral;
+    eigenMatrix _spec_evec; // eigenvectors of the GRM
+    vector<eigenVector> _spec_diag; // eigenvalues of the GRM and of the identity matrix
+    eigenVector _spec_y; // y and X rotated by the eigenvectors
+    eigenMatrix _spec_X;
+    int _reml_precision; // 0: double; 1: single; 2: mixed
+    vector<MatrixXf> _Af; // GRMs in single precision; the identity matrix of the residual is not stored
+    MatrixXf _Vi_f;
     
     // bivariate reml
     bool _bivar_reml;
@@ -17,6 +17,22 @@ void gcta::enable_grm_bin_flag()
 	_grm_bin_flag=true;
 }
 
+void gcta::enable_grm_part(int part_num, int part)
+{
+    _grm_part_num=part_num;
+    _grm_part=part;
+}
+
+void gcta::enable_grm_cbin_flag()
+{
+    _grm_cbin_flag=true;
+}
+
+void gcta::enable_grm_cbin_output(int type)
+{
+    _grm_cbin_type=type;
+}
+
 void gcta::check_autosome()
 {
     for(int i=0; i<_include.size(); i++){
@@ -42,34 +58,29 @@ void gcta::output_grm_MatrixXf(bool output_grm_bin)
 {
     int i=0, j=0;
     string grm_file;
-    if(output_grm_bin){
-        // Save matrix A in binary file
+    if(_grm_N.empty()) _grm_N.init(_grm.n());
+    if(_grm_cbin_type>-1){
+        grm_file=_out+".grm.cbin";
+        GrmCbin::write(grm_file, _grm.data(), _grm_N.data(), _grm.n(), _grm_cbin_type);
+        cout<<"GRM of "<<_keep.size()<<" individuals and the number of SNPs for each pair have been saved in the file ["+grm_file+"] (in chunked binary format)."<<endl;
+    }
+    else if(output_grm_bin){
+        // Save matrix A in binary file; _grm and _grm_N may map the files to be replaced (--out the same as --grm),
+        // so they are written to temporary files renamed once both are complete
         grm_file=_out+".grm.bin";
-        fstream A_Bin(grm_file.c_str(), ios::out|ios::binary);
-        if(!A_Bin) throw("Error: can not open the file ["+grm_file+"] to write.");
-		float f_buf=0.0;
-		int size=sizeof(float);
-        for(i=0; i<_keep.size(); i++){
-            for(j=0; j<=i; j++){
-				f_buf=(float)(_grm(i,j));
-				A_Bin.write((char*)&f_buf, size);
-			}
-        }
-        A_Bin.close();
-        cout<<"GRM of "<<_keep.size()<<" individuals has been saved in the file ["+grm_file+"] (in binary format)."<<endl;
-
         string grm_N_file=_out+".grm.N.bin";
-        fstream N_Bin(grm_N_file.c_str(), ios::out|ios::binary);
-        if(!N_Bin) throw("Error: can not open the file ["+grm_N_file+"] to write.");
-        f_buf=0.0;
-        size=sizeof(int);
-        for(i=0; i<_keep.size(); i++){
-            for(j=0; j<=i; j++){
-                f_buf=(float)(_grm_N(i,j));
-                N_Bin.write((char*)&f_buf, size);
-            }
-        }
+        fstream A_Bin((grm_file+".tmp").c_str(), ios::out|ios::binary);
+        if(!A_Bin) throw("Error: can not open the file ["+grm_file+".tmp] to write.");
+        A_Bin.write((char*)_grm.data(), _grm.n()*(_grm.n()+1)/2*sizeof(float));
+        A_Bin.close();
+        fstream N_Bin((grm_N_file+".tmp").c_str(), ios::out|ios::binary);
+        if(!N_Bin) throw("Error: can not open the file ["+grm_N_file+".tmp] to write.");
+        N_Bin.write((char*)_grm_N.data(), _grm_N.n()*(_grm_N.n()+1)/2*sizeof(float));
         N_Bin.close();
+        if(!A_Bin || !N_Bin) throw("Error: can not write the file ["+grm_file+"]. Please check the disk space.");
+        CommFunc::FileRename(grm_file+".tmp", grm_file);
+        CommFunc::FileRename(grm_N_file+".tmp", grm_N_file);
+        cout<<"GRM of "<<_keep.size()<<" individuals has been saved in the file ["+grm_file+"] (in binary format)."<<endl;
         cout<<"Number of SNPs to calcuate the genetic relationship between each pair of individuals has been saved in the file ["+grm_N_file+"] (in binary format)."<<endl;
     }
     else{
@@ -82,8 +93,7 @@ void gcta::output_grm_MatrixXf(bool output_grm_bin)
         zoutf.setf(ios::scientific);
         zoutf.precision(6);
         for(i=0; i<_keep.size(); i++){
-            if(_grm_N.rows()>0) for(j=0; j<=i; j++) zoutf<<i+1<<'\t'<<j+1<<'\t'<<(int)_grm_N(i,j)<<'\t'<<_grm(i,j)<<endl;
-            else for(j=0; j<=i; j++) zoutf<<i+1<<'\t'<<j+1<<"\t0\t"<<_grm(i,j)<<endl;
+            for(j=0; j<=i; j++) zoutf<<i+1<<'\t'<<j+1<<'\t'<<(int)_grm_N(i,j)<<'\t'<<_grm(i,j)<<'\n';
         }
         zoutf.close();
         cout<<"The genetic relationship matrix has been saved in the file ["+grm_file+"] (in compressed text format)."<<endl;
@@ -135,7 +145,8 @@ int gcta::read_grm_id(string grm_file, vector<string> &grm_id, bool out_id_log,
 
 void gcta::read_grm(string grm_file, vector<string> &grm_id, bool out_id_log, bool read_id_only)
 {
-	if(_grm_bin_flag) read_grm_bin(grm_file, grm_id, out_id_log, read_id_only);
+	if(_grm_cbin_flag) read_grm_cbin(grm_file, grm_id, out_id_log, read_id_only);
+	else if(_grm_bin_flag) read_grm_bin(grm_file, grm_id, out_id_log, read_id_only);
 	else read_grm_gz(grm_file, grm_id, out_id_log, read_id_only);
 }
 
@@ -156,22 +167,25 @@ void gcta::read_grm_gz(string grm_file, vector<string> &grm_id, bool out_id_log,
     double grm_buf=0.0, grm_N_buf;
     string errmsg="Error: failed to read ["+grm_gzfile+"]. The format of the GRM file has been changed?\nError occurs in line:\n";
     cout<<"Reading the GRM from ["+grm_gzfile+"]."<<endl;
-    _grm.resize(n,n);
-    _grm_N.resize(n,n);
+    _grm.init(n);
+    _grm_N.init(n);
+    _grm_N_file="";
     while(1){
         zinf.getline(buf, MAX_LINE_LENGTH, '\n');
         if(zinf.fail() || !zinf.good()) break;
-        stringstream ss(buf);
-        if(!(ss>>indx1)) throw(errmsg+buf);
-        if(!(ss>>indx2)) throw(errmsg+buf);
-        if(!(ss>>grm_N_buf)) throw(errmsg+buf);
-        if(!(ss>>grm_buf)) throw(errmsg+buf);
-		if(indx1 < indx2 || indx1>n || indx2>n) throw(errmsg+buf);
+        // parsed in place, a stringstream per line is slow for large GRMs
+        char *p=buf, *q=NULL;
+        indx1=strtol(p, &q, 10); if(q==p) throw(errmsg+buf); p=q;
+        indx2=strtol(p, &q, 10); if(q==p) throw(errmsg+buf); p=q;
+        grm_N_buf=strtod(p, &q); if(q==p) throw(errmsg+buf); p=q;
+        grm_buf=strtod(p, &q); if(q==p) throw(errmsg+buf); p=q;
+        while(isspace(*p)) p++;
+        if(*p!='\0') throw(errmsg+buf);
+		if(indx1 < indx2 || indx1<1 || indx2<1 || indx1>n || indx2>n) throw(errmsg+buf);
 		if(grm_N_buf==0) cout<<"Warning: "<<buf<<endl;
-		_grm_N(indx1-1,indx2-1)=_grm_N(indx2-1,indx1-1)=grm_N_buf;
-		_grm(indx1-1,indx2-1)=_grm(indx2-1,indx1-1)=grm_buf;
+		_grm_N(indx1-1,indx2-1)=grm_N_buf;
+		_grm(indx1-1,indx2-1)=grm_buf;
 		nline++;
-        if(ss>>str_buf) throw(errmsg+buf);
     }
     zinf.close();
     cout<<"Pairwise genetic relationships between "<<n<<" individuals are included from ["+grm_gzfile+"]."<<endl;
@@ -179,81 +193,89 @@ void gcta::read_grm_gz(string grm_file, vector<string> &grm_id, bool out_id_log,
 
 void gcta::read_grm_bin(string grm_file, vector<string> &grm_id, bool out_id_log, bool read_id_only)
 {
-    int i=0, j=0, n=read_grm_id(grm_file, grm_id, out_id_log, read_id_only);
+    int n=read_grm_id(grm_file, grm_id, out_id_log, read_id_only);
 	
     if(read_id_only) return;
 	
+    // the GRM is mapped rather than read; .grm.N.bin is only read if needed
     string grm_binfile=grm_file+".grm.bin";
-	ifstream A_bin(grm_binfile.c_str(), ios::in|ios::binary);
-	if(!A_bin.is_open()) throw("Error: can not open the file ["+grm_binfile+"] to read.");
-	_grm.resize(n,n);
     cout<<"Reading the GRM from ["+grm_binfile+"]."<<endl;
-	int size=sizeof(float);
-	float f_buf=0.0;
-	for(i=0; i<n; i++){
-		for(j=0; j<=i; j++){
-			if(!(A_bin.read((char*)&f_buf, size))) throw("Error: the size of the ["+grm_binfile+"] file is incomplete?");
-			_grm(j,i)=_grm(i,j)=f_buf;
-		}
-	}
-	A_bin.close();
-    
-    string grm_Nfile=grm_file+".grm.N.bin";
-    ifstream N_bin(grm_Nfile.c_str(), ios::in|ios::binary);
-    if(!N_bin.is_open()) throw("Error: can not open the file ["+grm_Nfile+"] to read.");
-    _grm_N.resize(n,n);
-    cout<<"Reading the number of SNPs for the GRM from ["+grm_Nfile+"]."<<endl;
-    size=sizeof(float);
-    f_buf=0.0;
-    for(i=0; i<n; i++){
-        for(j=0; j<=i; j++){
-            if(!(N_bin.read((char*)&f_buf, size))) throw("Error: the size of the ["+grm_Nfile+"] file is incomplete?");
-            _grm_N(j,i)=_grm_N(i,j)=f_buf;
-        }
-    }
-    N_bin.close();
+    _grm.map(grm_binfile, n);
+    _grm_N.clear();
+    _grm_N_file=grm_file+".grm.N.bin";
 	
     cout<<"Pairwise genetic relationships between "<<n<<" individuals are included from ["+grm_binfile+"]."<<endl;
 }
 
+void gcta::read_grm_cbin(string grm_file, vector<string> &grm_id, bool out_id_log, bool read_id_only)
+{
+    int n=read_grm_id(grm_file, grm_id, out_id_log, read_id_only);
+
+    if(read_id_only) return;
+
+    // the number of SNPs is in the same file, decompressed only if needed
+    string grm_cbinfile=grm_file+".grm.cbin";
+    cout<<"Reading the GRM from ["+grm_cbinfile+"]."<<endl;
+    if(GrmCbin::indi_num(grm_cbinfile)!=n) throw("Error: the number of individuals in ["+grm_cbinfile+"] does not match the number of IDs in ["+grm_file+".grm.id].");
+    _grm.init(n);
+    GrmCbin::read(grm_cbinfile, false, 0, n, _grm.data());
+    _grm_N.clear();
+    _grm_N_file=grm_cbinfile;
+
+    cout<<"Pairwise genetic relationships between "<<n<<" individuals are included from ["+grm_cbinfile+"]."<<endl;
+}
+
+void gcta::load_grm_N()
+{
+    if(!_grm_N.empty() || _grm_N_file.empty()) return;
+    cout<<"Reading the number of SNPs for the GRM from ["+_grm_N_file+"]."<<endl;
+    if(_grm_N_file.size()>9 && _grm_N_file.compare(_grm_N_file.size()-9, 9, ".grm.cbin")==0){
+        _grm_N.init(_grm.n());
+        GrmCbin::read(_grm_N_file, true, 0, _grm.n(), _grm_N.data());
+    }
+    else _grm_N.map(_grm_N_file, _grm.n());
+    _grm_N_file="";
+}
+
 void gcta::rm_cor_indi(double grm_cutoff)
 {
     cout<<"Pruning the GRM with a cutoff of "<<grm_cutoff<<" ..."<<endl;
 
-    int i=0, j=0, i_buf=0;
+    long i=0, j=0, k=0, n=_keep.size(), pair_num=0;
 
-    vector<int> rm_grm_ID1, rm_grm_ID2;
-    for(i=0; i<_keep.size(); i++){
+    // relatedness graph: the relatives of each individual among those before it in _keep
+    vector< vector<int> > rel(n);
+    const float *A=_grm.data();
+    #pragma omp parallel for private(j) schedule(dynamic, 64)
+    for(i=0; i<n; i++){
+        const float *row=A+tri_indx(_keep[i], 0);
         for(j=0; j<i; j++){
-            if(_grm(_keep[i],_keep[j])>grm_cutoff){
-                rm_grm_ID1.push_back(_keep[i]);
-                rm_grm_ID2.push_back(_keep[j]);
-            }
+            if(row[_keep[j]]>grm_cutoff) rel[i].push_back(j);
         }
     }
-    vector<int> rm_uni_ID(rm_grm_ID1);
-	rm_uni_ID.insert(rm_uni_ID.end(), rm_grm_ID2.begin(), rm_grm_ID2.end());
-    stable_sort(rm_uni_ID.begin(), rm_uni_ID.end());
-    rm_uni_ID.erase(unique(rm_uni_ID.begin(), rm_uni_ID.end()), rm_uni_ID.end());
-    map<int,int> rm_uni_ID_count;
-    for(i=0; i<rm_uni_ID.size(); i++){
-        i_buf=count(rm_grm_ID1.begin(), rm_grm_ID1.end(), rm_uni_ID[i])+count(rm_grm_ID2.begin(), rm_grm_ID2.end(), rm_uni_ID[i]);
-        rm_uni_ID_count.insert(pair<int,int>(rm_uni_ID[i], i_buf));
-    }
-    map<int,int>::iterator iter1, iter2;
-    for(i=0; i<rm_grm_ID1.size(); i++){
-        iter1=rm_uni_ID_count.find(rm_grm_ID1[i]);
-        iter2=rm_uni_ID_count.find(rm_grm_ID2[i]);
-        if(iter1->second < iter2->second){
-            i_buf=rm_grm_ID1[i];
-            rm_grm_ID1[i]=rm_grm_ID2[i];
-            rm_grm_ID2[i]=i_buf;
+
+    // number of relatives of each individual
+    vector<int> rel_num(n, 0);
+    for(i=0; i<n; i++){
+        rel_num[i]+=rel[i].size();
+        for(k=0; k<rel[i].size(); k++) rel_num[rel[i][k]]++;
+        pair_num+=rel[i].size();
+    }
+
+    // of each pair, remove the individual with more relatives (the latter one if tied)
+    vector<bool> rm_flag(n, false);
+    for(i=0; i<n; i++){
+        for(k=0; k<rel[i].size(); k++){
+            j=rel[i][k];
+            if(rel_num[i]<rel_num[j]) rm_flag[j]=true;
+            else rm_flag[i]=true;
         }
     }
-    stable_sort(rm_grm_ID1.begin(), rm_grm_ID1.end());
-    rm_grm_ID1.erase(unique(rm_grm_ID1.begin(), rm_grm_ID1.end()), rm_grm_ID1.end());
     vector<string> removed_ID;
-    for(i=0; i<rm_grm_ID1.size(); i++) removed_ID.push_back(_fid[rm_grm_ID1[i]]+":"+_pid[rm_grm_ID1[i]]);
+    for(i=0; i<n; i++){
+        if(rm_flag[i]) removed_ID.push_back(_fid[_keep[i]]+":"+_pid[_keep[i]]);
+    }
+    cout<<pair_num<<" pairs of individuals with a relatedness > "<<grm_cutoff<<"."<<endl;
 
     // update _keep and _id_map
     update_id_map_rm(removed_ID, _id_map, _keep);
@@ -264,6 +286,7 @@ void gcta::rm_cor_indi(double grm_cutoff)
 void gcta::adj_grm(double adj_grm_fac)
 {
     cout<<"Adjusting the GRM for sampling errors ..."<<endl;
+    load_grm_N();
     int i=0, j=0, n=_keep.size();
     double off_mean=0.0, diag_mean=0.0, off_var=0.0, diag_var=0.0, d_buf=0.0;
     for(i=0; i<n; i++){
@@ -310,13 +333,12 @@ void gcta::dc(int dosage_compen)
     }
 }
 
-void gcta::manipulate_grm(string grm_file, string keep_indi_file, string remove_indi_file, string sex_file, double grm_cutoff, double adj_grm_fac, int dosage_compen, bool merge_grm_flag)
+void gcta::manipulate_grm(string grm_file, string keep_indi_file, string remove_indi_file, string sex_file, double grm_cutoff, double adj_grm_fac, int dosage_compen, bool merge_grm_flag, bool grm_N_flag)
 {
-    int i=0, j=0;
-
     vector<string> grm_id;
     if(merge_grm_flag) merge_grm(grm_file);
     else read_grm(grm_file, grm_id);
+    if(grm_N_flag) load_grm_N();
 
     if(!keep_indi_file.empty()) keep_indi(keep_indi_file);
     if(!remove_indi_file.empty()) remove_indi(remove_indi_file);
@@ -324,57 +346,239 @@ void gcta::manipulate_grm(string grm_file, string keep_indi_file, string remove_
     if(!sex_file.empty()) update_sex(sex_file);
     if(adj_grm_fac>-1.0) adj_grm(adj_grm_fac);
     if(dosage_compen>-1) dc(dosage_compen);
-    if(grm_cutoff>-1.0 || !keep_indi_file.empty() || !remove_indi_file.empty()){
-        eigenMatrix tmp(_grm);
-        _grm.resize(_keep.size(),_keep.size());
-        for(i=0; i<_keep.size(); i++){
-            for(j=0; j<=i; j++) _grm(i,j)=tmp(_keep[i],_keep[j]);
-        }
-        tmp=_grm_N;
-        _grm_N.resize(_keep.size(),_keep.size());
-        for(i=0; i<_keep.size(); i++){
-            for(j=0; j<=i; j++) _grm_N(i,j)=tmp(_keep[i],_keep[j]);
-        }
+    if(_keep.size()<_grm.n()){
+        _grm.subset(_keep);
+        if(!_grm_N.empty()) _grm_N.subset(_keep);
     }
 }
 
 void gcta::save_grm(string grm_file, string keep_indi_file, string remove_indi_file, string sex_file, double grm_cutoff, double adj_grm_fac, int dosage_compen, bool merge_grm_flag, bool output_grm_bin)
 {
+    // GRMs are merged block by block unless the whole merged GRM is needed
+    if(merge_grm_flag && grm_cutoff<=-1.0 && adj_grm_fac<=-1.0 && dosage_compen<=-1 && (_grm_bin_flag || _grm_cbin_flag) && _grm_cbin_type<0){
+        merge_grm_stream(grm_file, keep_indi_file, remove_indi_file, output_grm_bin);
+        return;
+    }
     if(dosage_compen>-1) check_sex();
     manipulate_grm(grm_file, keep_indi_file, remove_indi_file, sex_file, grm_cutoff, adj_grm_fac, dosage_compen, merge_grm_flag);
     output_grm_MatrixXf(output_grm_bin);
 }
 
-void gcta::pca(string grm_file, string keep_indi_file, string remove_indi_file, double grm_cutoff, bool merge_grm_flag, int out_pc_num)
+void gcta::pca(string grm_file, string keep_indi_file, string remove_indi_file, double grm_cutoff, bool merge_grm_flag, int out_pc_num, bool approx_flag, double approx_tol)
 {
-    manipulate_grm(grm_file, keep_indi_file, remove_indi_file, "", grm_cutoff, -2.0, -2, merge_grm_flag);
-    _grm_N.resize(0,0);
+    manipulate_grm(grm_file, keep_indi_file, remove_indi_file, "", grm_cutoff, -2.0, -2, merge_grm_flag, false);
+    _grm_N.clear();
     int i=0, j=0, n=_keep.size();
-    cout<<"\nPerforming principal component analysis ..."<<endl;
-    
-    SelfAdjointEigenSolver<MatrixXd> eigensolver(_grm.cast<double>());
-    MatrixXd evec=(eigensolver.eigenvectors());
-    VectorXd eval=eigensolver.eigenvalues();
+    if(out_pc_num>n) out_pc_num=n;
+    MatrixXd evec;
+    VectorXd eval;
+
+    // the eigendecomposition saved by --make-grm-eigen
+    string eigen_file=grm_file+".grm.eigen";
+    ifstream i_eigen(eigen_file.c_str());
+    bool eigen_flag=(!merge_grm_flag && i_eigen);
+    i_eigen.close();
+    if(eigen_flag){
+        vector<string> id(n);
+        for(i=0; i<n; i++) id[i]=_fid[_keep[i]]+":"+_pid[_keep[i]];
+        eigen_flag=read_grm_eigen(grm_file, id, grm_digest(_grm, id), eval, evec, true);
+        if(eigen_flag){
+            _grm.clear();
+            approx_flag=false;
+        }
+    }
+    if(eigen_flag) cout<<"\nPrincipal component analysis from the saved eigendecomposition of the GRM."<<endl;
+    else if(approx_flag){
+        cout<<"\nPerforming principal component analysis for the first "<<out_pc_num<<" eigenvectors (tolerance "<<approx_tol<<") ..."<<endl;
+        eigen_approx(n, out_pc_num, approx_tol, &gcta::grm_mult, eval, evec);
+        _grm.clear();
+    }
+    else{
+        cout<<"\nPerforming principal component analysis ..."<<endl;
 
+        // the solver only reads the lower triangle
+        MatrixXd A(n, n);
+        for(i=0; i<n; i++){
+            for(j=0; j<=i; j++) A(i,j)=_grm(i,j);
+        }
+        _grm.clear();
+        SelfAdjointEigenSolver<MatrixXd> eigensolver(A);
+        A.resize(0,0);
+        evec=eigensolver.eigenvectors().rowwise().reverse();
+        eval=eigensolver.eigenvalues().reverse();
+    }
+
+    output_pca(eval, evec, out_pc_num, !approx_flag);
+}
+
+void gcta::output_pca(const VectorXd &eval, const MatrixXd &evec, int out_pc_num, bool all_eval)
+{
+    int i=0, j=0, n=_keep.size();
     string eval_file=_out+".eigenval";
     ofstream o_eval(eval_file.c_str());
     if(!o_eval) throw("Error: can not open the file ["+eval_file+"] to read.");
-    for(i=_keep.size()-1; i>=0; i--) o_eval<<eval(i)<<endl;
+    for(i=0; i<eval.size(); i++) o_eval<<eval(i)<<endl;
     o_eval.close();
-    cout<<"Eigenvalues of "<<n<<" individuals have been saved in ["+eval_file+"]."<<endl;
+    if(all_eval) cout<<"Eigenvalues of "<<n<<" individuals have been saved in ["+eval_file+"]."<<endl;
+    else cout<<"The first "<<eval.size()<<" eigenvalues of "<<n<<" individuals have been saved in ["+eval_file+"]."<<endl;
     string evec_file=_out+".eigenvec";
     ofstream o_evec(evec_file.c_str());
     if(!o_evec) throw("Error: can not open the file ["+evec_file+"] to read.");
-    if(out_pc_num>n) out_pc_num=n;
     for(i=0; i<n; i++){
         o_evec<<_fid[_keep[i]]<<" "<<_pid[_keep[i]];
-        for(j=n-1; j>=(n-out_pc_num); j--) o_evec<<" "<<evec(i,j);
+        for(j=0; j<out_pc_num; j++) o_evec<<" "<<evec(i,j);
         o_evec<<endl;
     }
     o_evec.close();
     cout<<"The first "<<out_pc_num<<" eigenvectors of "<<n<<" individuals have been saved in ["+evec_file+"]."<<endl;
 }
 
+void gcta::save_grm_eigen(string grm_file, string keep_indi_file, string remove_indi_file, double grm_cutoff, bool merge_grm_flag)
+{
+    // .grm.eigen: a header of 64 bytes ("GRMEIGEN", then the number of individuals and the digest of the IDs and the GRM
+    // as 64-bit integers, then zeros), followed by the eigenvalues in ascending order and the eigenvectors column by column,
+    // all in double precision
+    manipulate_grm(grm_file, keep_indi_file, remove_indi_file, "", grm_cutoff, -2.0, -2, merge_grm_flag, false);
+    _grm_N.clear();
+    int i=0, j=0, n=_keep.size();
+    vector<string> id(n);
+    for(i=0; i<n; i++) id[i]=_fid[_keep[i]]+":"+_pid[_keep[i]];
+    eigenMatrix A(n, n);
+    for(i=0; i<n; i++){
+        for(j=0; j<=i; j++) A(i,j)=_grm(i,j);
+    }
+    _grm.clear();
+    int64_t header[8]={0};
+    header[1]=n;
+    header[2]=(int64_t)grm_digest(A, id);
+    for(i=0; i<8; i++) ((char *)header)[i]="GRMEIGEN"[i];
+
+    cout<<"\nPerforming the eigendecomposition of the GRM ..."<<endl;
+    eigenVector eval;
+    if(!eigen_sym_mkl(A, eval)) throw("Error: the eigendecomposition of the GRM failed.");
+    string eigen_file=_out+".grm.eigen";
+    fstream o_eigen(eigen_file.c_str(), ios::out|ios::binary);
+    if(!o_eigen) throw("Error: can not open the file ["+eigen_file+"] to write.");
+    o_eigen.write((char *)header, 64);
+    vector<double> buf(n);
+    for(i=0; i<n; i++) buf[i]=eval(i);
+    o_eigen.write((char *)&buf[0], n*sizeof(double));
+    for(j=0; j<n; j++){
+        for(i=0; i<n; i++) buf[i]=A(i,j);
+        o_eigen.write((char *)&buf[0], n*sizeof(double));
+    }
+    if(!o_eigen) throw("Error: failed to write the file ["+eigen_file+"].");
+    o_eigen.close();
+    cout<<"Eigenvalues and eigenvectors of the GRM of "<<n<<" individuals have been saved in the file ["+eigen_file+"] (in binary format)."<<endl;
+}
+
+template<typename VecType, typename MatType>
+bool gcta::read_grm_eigen(string grm_file, const vector<string> &id, uint64_t digest, VecType &eval, MatType &evec, bool descend_flag)
+{
+    // the file is only used if it has been saved from the same GRM of the same individuals in the same order;
+    // the eigenpairs are read straight into eval and evec, in descending order of the eigenvalues if descend_flag
+    string eigen_file=grm_file+".grm.eigen";
+    fstream i_eigen(eigen_file.c_str(), ios::in|ios::binary);
+    if(!i_eigen) return false;
+    int64_t header[8]={0};
+    i_eigen.read((char *)header, 64);
+    if(!i_eigen || string((char *)header, 8)!="GRMEIGEN") throw("Error: ["+eigen_file+"] is not a file saved by --make-grm-eigen.");
+    if(header[1]!=id.size() || (uint64_t)header[2]!=digest){
+        cout<<"Note: the eigendecomposition in ["+eigen_file+"] is not used because it is not of the GRM of the individuals in this analysis."<<endl;
+        return false;
+    }
+    cout<<"Reading the eigendecomposition of the GRM from ["+eigen_file+"]."<<endl;
+    int i=0, j=0, k=0, n=id.size();
+    vector<double> buf(n);
+    eval.resize(n);
+    evec.resize(n, n);
+    i_eigen.read((char *)&buf[0], n*sizeof(double));
+    for(i=0; i<n; i++) eval(descend_flag?n-1-i:i)=buf[i];
+    for(j=0; j<n; j++){
+        i_eigen.read((char *)&buf[0], n*sizeof(double));
+        k=(descend_flag?n-1-j:j);
+        for(i=0; i<n; i++) evec(i,k)=buf[i];
+    }
+    if(!i_eigen) throw("Error: the file ["+eigen_file+"] is incomplete.");
+    i_eigen.close();
+    return true;
+}
+
+template bool gcta::read_grm_eigen(string grm_file, const vector<string> &id, uint64_t digest, VectorXf &eval, MatrixXf &evec, bool descend_flag);
+template bool gcta::read_grm_eigen(string grm_file, const vector<string> &id, uint64_t digest, VectorXd &eval, MatrixXd &evec, bool descend_flag);
+
+void gcta::eigen_approx(int n, int k, double tol, void (gcta::*mult)(const MatrixXd &, MatrixXd &), VectorXd &eval, MatrixXd &evec)
+{
+    // the first k eigenpairs (in descending order of the eigenvalues) of a symmetric n x n matrix A, given by its
+    // product with a block of vectors, by restarted block Lanczos: a Krylov basis [Q, AQ, ..., A^(q-1)Q] of blocks of b vectors
+    // is orthonormalised and reduced by Rayleigh-Ritz, and the leading b Ritz vectors start the next cycle
+    // until ||Ax-lx||/l_1 < tol for all k Ritz pairs
+    int i=0, j=0, r=0, cycle=0, max_cycle=200, b=max(2*k, k+10), q=4, m=0, seed=-2013;
+    MatrixXd Y;
+    if(q*b>=n){
+        // the Krylov basis would span the whole space
+        (this->*mult)(MatrixXd::Identity(n, n), Y);
+        SelfAdjointEigenSolver<MatrixXd> eigensolver(Y);
+        eval=eigensolver.eigenvalues().reverse().head(k);
+        evec=eigensolver.eigenvectors().rowwise().reverse().leftCols(k);
+        return;
+    }
+    MatrixXd K(n, q*b), AK(n, q*b), W, S, T;
+    for(j=0; j<b; j++){
+        for(i=0; i<n; i++) K(i,j)=StatFunc::gasdev(seed);
+    }
+    K.leftCols(b)=HouseholderQR<MatrixXd>(K.leftCols(b)).householderQ()*MatrixXd::Identity(n, b);
+    (this->*mult)(K.leftCols(b), Y);
+    AK.leftCols(b)=Y;
+    double res=0.0;
+    for(cycle=0; cycle<max_cycle; cycle++){
+        // extend the basis, orthogonalising each new block twice against the previous ones
+        for(m=1; m<q; m++){
+            W=AK.middleCols((m-1)*b, b);
+            double w_norm=W.norm();
+            for(i=0; i<2; i++) W-=K.leftCols(m*b)*(K.leftCols(m*b).transpose()*W);
+            HouseholderQR<MatrixXd> qr(W);
+            K.middleCols(m*b, b)=qr.householderQ()*MatrixXd::Identity(n, b);
+            for(j=0; j<b && fabs(qr.matrixQR()(j,j))>1e-6*w_norm; j++);
+            if(j<b){
+                // breakdown: the block is (nearly) in the span of the basis, and the columns of Q it does not determine are
+                // not orthogonal to the basis. Q is orthogonalised against the basis again, and the columns with little left
+                // are replaced by random vectors orthogonalised against the basis
+                W=K.middleCols(m*b, b);
+                W-=K.leftCols(m*b)*(K.leftCols(m*b).transpose()*W);
+                qr.compute(W);
+                for(j=0, r=0; j<b; j++){
+                    if(fabs(qr.matrixQR()(j,j))>0.5) continue;
+                    for(i=0; i<n; i++) W(i,j)=StatFunc::gasdev(seed);
+                    r++;
+                }
+                if(r>0){
+                    for(i=0; i<2; i++) W-=K.leftCols(m*b)*(K.leftCols(m*b).transpose()*W);
+                    qr.compute(W);
+                }
+                K.middleCols(m*b, b)=qr.householderQ()*MatrixXd::Identity(n, b);
+            }
+            (this->*mult)(K.middleCols(m*b, b), Y);
+            AK.middleCols(m*b, b)=Y;
+        }
+        T=K.transpose()*AK;
+        SelfAdjointEigenSolver<MatrixXd> eigensolver(0.5*(T+T.transpose()));
+        S=eigensolver.eigenvectors().rowwise().reverse().leftCols(b);
+        eval=eigensolver.eigenvalues().reverse().head(b);
+        W=K*S;
+        Y=AK*S;
+        for(j=0, res=0.0; j<k; j++) res=max(res, (Y.col(j)-eval(j)*W.col(j)).norm());
+        res/=fabs(eval(0));
+        K.leftCols(b)=W;
+        AK.leftCols(b)=Y;
+        if(res<tol) break;
+    }
+    eval.conservativeResize(k);
+    evec=K.leftCols(k);
+    if(cycle==max_cycle) cout<<"Warning: the eigenvectors have not converged after "<<max_cycle*(q-1)+1<<" multiplications with the GRM (residual = "<<res<<")."<<endl;
+    else cout<<"Eigenvectors converged after "<<(cycle+1)*(q-1)+1<<" multiplications with the GRM (residual = "<<res<<")."<<endl;
+}
+
 void gcta::merge_grm(string merge_grm_file)
 {
     vector<string> grm_files, grm_id;
@@ -391,36 +595,239 @@ void gcta::merge_grm(string merge_grm_file)
 	if(_n==0) throw("Error: no individual is in common in the GRM files.");
 	else cout<<_n<<" individuals in common in the GRM files."<<endl;
 
+    // the merged GRM is kept at the positions of the individuals in the first GRM, as _keep
+    unsigned long k=0, l=0, n=_keep.back()+1;
     vector<int> kp;
-    eigenMatrix grm=eigenMatrix::Zero(_n, _n);
-    eigenMatrix grm_N=eigenMatrix::Zero(_n, _n);
+    vector<double> grm(n*(n+1)/2);
+    GrmStore grm_N;
+    grm_N.init(n);
     for(f=0; f<grm_files.size(); f++){
         cout<<"Reading the GRM from the "<<f+1<<"th file ..."<<endl;
         read_grm(grm_files[f], grm_id);
+        load_grm_N();
         StrFunc::match(uni_id, grm_id, kp);
+        #pragma omp parallel for private(j, k, l)
         for(i=0; i<_n; i++){
+            k=(unsigned long)_keep[i]*(_keep[i]+1)/2;
             for(j=0; j<=i; j++){
-                if(kp[i]>=kp[j]){
-                    grm(i,j)+=_grm(kp[i],kp[j])*_grm_N(kp[i],kp[j]);
-                    grm_N(i,j)+=_grm_N(kp[i],kp[j]);
+                l=k+_keep[j];
+                grm[l]+=_grm(kp[i],kp[j])*_grm_N(kp[i],kp[j]);
+                grm_N.data()[l]+=_grm_N(kp[i],kp[j]);
+            }
+        }        
+    }
+    _grm.init(n);
+    for(l=0; l<grm.size(); l++){
+        if(grm_N.data()[l]==0) _grm.data()[l]=0;
+        else _grm.data()[l]=grm[l]/grm_N.data()[l];
+    }
+    _grm_N.swap(grm_N);
+    _grm_N_file="";
+    vector<double>().swap(grm);
+    cout<<"\n"<<grm_files.size()<<" GRMs have been merged together."<<endl;
+}
+
+// the GRM of n individuals in grm_file.grm.cbin, written as file.grm.bin and file.grm.N.bin one block of rows at a time
+void gcta::unpack_grm_cbin(string grm_file, unsigned long n, string file)
+{
+    unsigned long r_start=0, r_end=0, t_size=0;
+    string bin_file=file+".grm.bin", bin_N_file=file+".grm.N.bin";
+    fstream A_Bin(bin_file.c_str(), ios::out|ios::binary), N_Bin(bin_N_file.c_str(), ios::out|ios::binary);
+    if(!A_Bin) throw("Error: can not open the file ["+bin_file+"] to write.");
+    if(!N_Bin) throw("Error: can not open the file ["+bin_N_file+"] to write.");
+    vector<float> A, A_N;
+    for(r_start=0; r_start<n; r_start=r_end){
+        // about 2^22 elements per block
+        for(r_end=r_start, t_size=0; r_end<n && t_size<(1UL<<22); r_end++) t_size+=r_end+1;
+        A.resize(t_size);
+        A_N.resize(t_size);
+        GrmCbin::read(grm_file+".grm.cbin", false, r_start, r_end, &A[0]);
+        GrmCbin::read(grm_file+".grm.cbin", true, r_start, r_end, &A_N[0]);
+        A_Bin.write((char*)&A[0], t_size*sizeof(float));
+        N_Bin.write((char*)&A_N[0], t_size*sizeof(float));
+    }
+    A_Bin.close();
+    N_Bin.close();
+    if(!A_Bin || !N_Bin) throw("Error: can not write the file ["+bin_file+"]. Please check the disk space.");
+}
+
+void gcta::merge_grm_stream(string merge_grm_file, string keep_indi_file, string remove_indi_file, bool output_grm_bin)
+{
+    // the merged GRM is calculated and written one block of rows at a time. The input GRMs are mapped (.grm.bin)
+    // or read by blocks of rows (.grm.cbin) so that only the rows of the current block are held in memory; a .grm.cbin
+    // whose individuals are in another order is first decompressed by blocks of rows into a temporary .grm.bin,
+    // which is then mapped
+    vector<string> grm_files, grm_id;
+    read_grm_filenames(merge_grm_file, grm_files);
+
+    long f=0, i=0, j=0, nf=grm_files.size();
+    for(f=0; f<nf; f++){
+        read_grm(grm_files[f], grm_id, false, true);
+        update_id_map_kp(grm_id, _id_map, _keep);
+    }
+    if(!keep_indi_file.empty()) keep_indi(keep_indi_file);
+    if(!remove_indi_file.empty()) remove_indi(remove_indi_file);
+    vector<string> uni_id;
+	for(i=0; i<_keep.size(); i++) uni_id.push_back(_fid[_keep[i]]+":"+_pid[_keep[i]]);
+	unsigned long n=uni_id.size();
+	if(n==0) throw("Error: no individual is in common in the GRM files.");
+	else cout<<n<<" individuals in common in the GRM files."<<endl;
+
+    // positions of the individuals in each GRM; a block of rows of the merged GRM is a block of rows of the
+    // input GRM if the individuals are in the same order
+    vector< vector<int> > kp(nf);
+    vector<bool> sorted_flag(nf);
+    vector<GrmStore *> G(nf), G_N(nf);
+
+    // the temporary files are removed however the merge ends
+    struct TmpFiles{
+        vector<string> files;
+        ~TmpFiles(){
+            for(unsigned long f=0; f<files.size(); f++) remove(files[f].c_str());
+        }
+    } tmp;
+    for(f=0; f<nf; f++){
+        read_grm_id(grm_files[f], grm_id, false, true);
+        StrFunc::match(uni_id, grm_id, kp[f]);
+        sorted_flag[f]=true;
+        for(i=1; i<n; i++){
+            if(kp[f][i]<kp[f][i-1]) sorted_flag[f]=false;
+        }
+        G[f]=new GrmStore;
+        G_N[f]=new GrmStore;
+        if(!_grm_cbin_flag){
+            G[f]->map(grm_files[f]+".grm.bin", grm_id.size());
+            G_N[f]->map(grm_files[f]+".grm.N.bin", grm_id.size());
+        }
+        else if(!sorted_flag[f]){
+            // mapped and read in any order like an unsorted .grm.bin
+            stringstream ss;
+            ss<<_out<<".merge_tmp_"<<f;
+            tmp.files.push_back(ss.str()+".grm.bin");
+            tmp.files.push_back(ss.str()+".grm.N.bin");
+            unpack_grm_cbin(grm_files[f], grm_id.size(), ss.str());
+            G[f]->map(ss.str()+".grm.bin", grm_id.size());
+            G_N[f]->map(ss.str()+".grm.N.bin", grm_id.size());
+        }
+    }
+
+    // the .grm.bin and .grm.N.bin files are written under temporary names and renamed at the end, as they may
+    // replace input GRMs that are still mapped (--out the same as one of the GRMs)
+    string grm_file=_out+(output_grm_bin?".grm.bin":".grm.gz"), grm_N_file=_out+".grm.N.bin";
+    fstream A_Bin, N_Bin;
+    gzofstream zoutf;
+    if(output_grm_bin){
+        tmp.files.push_back(grm_file+".tmp");
+        tmp.files.push_back(grm_N_file+".tmp");
+        A_Bin.open((grm_file+".tmp").c_str(), ios::out|ios::binary);
+        if(!A_Bin) throw("Error: can not open the file ["+grm_file+".tmp] to write.");
+        N_Bin.open((grm_N_file+".tmp").c_str(), ios::out|ios::binary);
+        if(!N_Bin) throw("Error: can not open the file ["+grm_N_file+".tmp] to write.");
+    }
+    else{
+        zoutf.open(grm_file.c_str());
+        if(!zoutf.is_open()) throw("Error: can not open the file ["+grm_file+"] to write.");
+        zoutf.setf(ios::scientific);
+        zoutf.precision(6);
+    }
+
+    cout<<"Merging "<<nf<<" GRMs block by block ..."<<endl;
+    unsigned long r_start=0, r_end=0, t_start=0, t_end=0, lo=0, hi=0, k=0, off=0;
+    vector<double> sum, sum_N;
+    vector<float> buf, buf_N, A, A_N;
+    for(r_start=0; r_start<n; r_start=r_end){
+        // about 2^22 elements per block
+        for(r_end=r_start, t_end=0; r_end<n && t_end<(1UL<<22); r_end++) t_end+=r_end+1;
+        t_start=r_start*(r_start+1)/2;
+        t_end=r_end*(r_end+1)/2;
+        sum.assign(t_end-t_start, 0.0);
+        sum_N.assign(t_end-t_start, 0.0);
+        for(f=0; f<nf; f++){
+            const vector<int> &kf=kp[f];
+            const float *g=NULL, *g_N=NULL;
+            if(sorted_flag[f]){
+                // rows kf[r_start] to kf[r_end-1] of this GRM, element (i,j) at g[tri_indx(i,j)-off]
+                lo=kf[r_start];
+                hi=kf[r_end-1]+1;
+                if(!G[f]->empty()){
+                    g=G[f]->data();
+                    g_N=G_N[f]->data();
+                    off=0;
                 }
                 else{
-                    grm(i,j)+=_grm(kp[j],kp[i])*_grm_N(kp[j],kp[i]);
-                    grm_N(i,j)+=_grm_N(kp[j],kp[i]);
+                    buf.resize(hi*(hi+1)/2-lo*(lo+1)/2);
+                    buf_N.resize(buf.size());
+                    GrmCbin::read(grm_files[f]+".grm.cbin", false, lo, hi, &buf[0]);
+                    GrmCbin::read(grm_files[f]+".grm.cbin", true, lo, hi, &buf_N[0]);
+                    g=&buf[0];
+                    g_N=&buf_N[0];
+                    off=lo*(lo+1)/2;
                 }
             }
-        }        
-    }
-    for(i=0; i<_n; i++){
-        for(j=0; j<=i; j++){
-            if(grm_N(i,j)==0) _grm(i,j)=0;
-            else _grm(i,j)=grm(i,j)/grm_N(i,j);
-            _grm_N(i,j)=grm_N(i,j);
+            #pragma omp parallel for private(j, k) schedule(dynamic, 16)
+            for(i=r_start; i<r_end; i++){
+                double *s=&sum[i*(i+1)/2-t_start], *s_N=&sum_N[i*(i+1)/2-t_start];
+                if(sorted_flag[f]){
+                    const float *p=g+(tri_indx(kf[i], 0)-off), *p_N=g_N+(tri_indx(kf[i], 0)-off);
+                    for(j=0; j<=i; j++){
+                        k=kf[j];
+                        s[j]+=(double)p[k]*p_N[k];
+                        s_N[j]+=p_N[k];
+                    }
+                }
+                else{
+                    const GrmStore &Gf=*G[f], &Gf_N=*G_N[f];
+                    for(j=0; j<=i; j++){
+                        s[j]+=(double)Gf(kf[i], kf[j])*Gf_N(kf[i], kf[j]);
+                        s_N[j]+=Gf_N(kf[i], kf[j]);
+                    }
+                }
+            }
+        }
+
+        // write the block
+        A.resize(sum.size());
+        A_N.resize(sum.size());
+        for(k=0; k<sum.size(); k++){
+            A_N[k]=sum_N[k];
+            if(sum_N[k]==0) A[k]=0.0;
+            else A[k]=sum[k]/sum_N[k];
+        }
+        if(output_grm_bin){
+            A_Bin.write((char*)&A[0], A.size()*sizeof(float));
+            N_Bin.write((char*)&A_N[0], A_N.size()*sizeof(float));
+        }
+        else{
+            for(i=r_start, k=0; i<r_end; i++){
+                for(j=0; j<=i; j++, k++) zoutf<<i+1<<'\t'<<j+1<<'\t'<<(int)A_N[k]<<'\t'<<A[k]<<'\n';
+            }
         }
     }
-    grm.resize(0,0);
-    grm_N.resize(0,0);
-    cout<<"\n"<<grm_files.size()<<" GRMs have been merged together."<<endl;
+    for(f=0; f<nf; f++){
+        delete G[f];
+        delete G_N[f];
+    }
+    cout<<nf<<" GRMs have been merged together."<<endl;
+
+    if(output_grm_bin){
+        A_Bin.close();
+        N_Bin.close();
+        if(!A_Bin || !N_Bin) throw("Error: can not write the file ["+grm_file+"]. Please check the disk space.");
+        CommFunc::FileRename(grm_file+".tmp", grm_file);
+        CommFunc::FileRename(grm_N_file+".tmp", grm_N_file);
+        cout<<"GRM of "<<n<<" individuals has been saved in the file ["+grm_file+"] (in binary format)."<<endl;
+        cout<<"Number of SNPs to calcuate the genetic relationship between each pair of individuals has been saved in the file ["+grm_N_file+"] (in binary format)."<<endl;
+    }
+    else{
+        zoutf.close();
+        cout<<"The genetic relationship matrix has been saved in the file ["+grm_file+"] (in compressed text format)."<<endl;
+    }
+    string famfile=_out+".grm.id";
+	ofstream Fam(famfile.c_str());
+	if(!Fam) throw("Error: can not open the file ["+famfile+"] to write.");
+	for(i=0; i<n; i++) Fam<<_fid[_keep[i]]+"\t"+_pid[_keep[i]]<<endl;
+	Fam.close();
+	cout<<"IDs for the GRM file ["+grm_file+"] have been saved in the file ["+famfile+"]."<<endl;
 }
 
 void gcta::read_grm_filenames(string merge_grm_file, vector<string> &grm_files, bool out_log)
@@ -436,6 +843,61 @@ void gcta::read_grm_filenames(string merge_grm_file, vector<string> &grm_files,
         }
     }
     if(out_log) cout<<"There are "<<grm_files.size()<<" GRM file names specified in ["+merge_grm_file+"]."<<endl;
-    if(grm_files.size()>1000) throw("Error: too many GRM file names specified in ["+merge_grm_file+"]. Maximum is 1000.");
     if(grm_files.size()<1) throw("Error: no GRM file name is found in ["+merge_grm_file+"].");
 }
+
+void gcta::merge_grm_part(string grm_file, int part_num)
+{
+    // the parts hold consecutive rows of the lower triangle, so they are merged by concatenation
+    int k=0, f=0;
+    unsigned long n=0, r_start=0, size=0;
+    string suffix[2]={".grm.bin", ".grm.N.bin"}, str_buf;
+    vector<char> buf(1<<20);
+    ofstream o_bin[2];
+    for(f=0; f<2; f++){
+        o_bin[f].open((_out+suffix[f]).c_str(), ios::out|ios::binary);
+        if(!o_bin[f]) throw("Error: can not open the file ["+_out+suffix[f]+"] to write.");
+    }
+    string famfile=_out+".grm.id";
+	ofstream Fam(famfile.c_str());
+	if(!Fam) throw("Error: can not open the file ["+famfile+"] to write.");
+
+    cout<<"Merging "<<part_num<<" parts of the GRM from ["+grm_file+"] ..."<<endl;
+    for(k=1; k<=part_num; k++){
+        stringstream ss;
+        ss<<grm_file<<".part_"<<part_num<<"_"<<k;
+        string part_file=ss.str();
+
+        // IDs of the rows in this part
+        string id_file=part_file+".grm.id";
+        ifstream i_id(id_file.c_str());
+        if(!i_id) throw("Error: can not open the file ["+id_file+"] to read.");
+        r_start=n;
+        while(getline(i_id, str_buf)){
+            if(str_buf.empty()) continue;
+            Fam<<str_buf<<endl;
+            n++;
+        }
+        i_id.close();
+
+        for(f=0; f<2; f++){
+            string bin_file=part_file+suffix[f];
+            ifstream i_bin(bin_file.c_str(), ios::in|ios::binary);
+            if(!i_bin) throw("Error: can not open the file ["+bin_file+"] to read.");
+            size=0;
+            while(i_bin){
+                i_bin.read(&buf[0], buf.size());
+                o_bin[f].write(&buf[0], i_bin.gcount());
+                size+=i_bin.gcount();
+            }
+            i_bin.close();
+            if(size!=(n*(n+1)/2-r_start*(r_start+1)/2)*sizeof(float)) throw("Error: the size of the ["+bin_file+"] file does not match the number of IDs in ["+id_file+"]. The part is incomplete?");
+        }
+        cout<<"Part "<<k<<": rows "<<r_start+1<<" to "<<n<<" of the GRM read from ["+part_file+"]."<<endl;
+    }
+    for(f=0; f<2; f++) o_bin[f].close();
+    Fam.close();
+    cout<<"GRM of "<<n<<" individuals has been saved in the file ["+_out+".grm.bin] (in binary format)."<<endl;
+    cout<<"Number of SNPs to calcuate the genetic relationship between each pair of individuals has been saved in the file ["+_out+".grm.N.bin] (in binary format)."<<endl;
+    cout<<"IDs for the GRM file ["+_out+".grm.bin] have been saved in the file ["+famfile+"]."<<endl;
+}
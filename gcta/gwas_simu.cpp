@@ -86,7 +86,7 @@ void gcta::save_phenfile(vector< vector<double> > &y)
 
 void gcta::GWAS_simu(string bfile, int simu_num, string qtl_file, int case_num, int control_num, double hsq, double K, int seed, bool output_causal, bool simu_emb_flag)
 {
-	int i=0, j=0;
+	int i=0, j=0, code=0;
 	bool cc_flag=false;
 	if(case_num>0 || control_num>0) cc_flag=true;
 
@@ -198,8 +198,9 @@ void gcta::GWAS_simu(string bfile, int simu_num, string qtl_file, int case_num,
             if(y[0][i]==-9) continue;
             out_emBayesB<<_pid[_keep[i]]<<" "<<g[i]<<" "<<y[0][i]<<endl;
             for(j=0; j<_include.size(); j++){
-                if(_snp_1[_include[j]][_keep[i]] && !_snp_2[_include[j]][_keep[i]]) out_emBayesB<<_mu[_include[j]]<<" ";
-                else out_emBayesB<<(double)(_snp_1[_include[j]][_keep[i]]+_snp_2[_include[j]][_keep[i]])<<" ";
+                code=_geno.get(_include[j], _keep[i]);
+                if(GenoStore::miss(code)) out_emBayesB<<_mu[_include[j]]<<" ";
+                else out_emBayesB<<(double)GenoStore::dose(code)<<" ";
             }
             out_emBayesB<<endl;
         }
@@ -667,8 +668,7 @@ void gcta::simu_geno_unlinked(int N, int M, double maf)
     _genet_dst.resize(M);
     _allele1.resize(M);
     _allele2.resize(M);
-    _snp_1.resize(M);
-    _snp_2.resize(M);
+    _geno.init(M, N);
 
 //double p=0.0;
     std::tr1::minstd_rand eng;
@@ -686,8 +686,6 @@ void gcta::simu_geno_unlinked(int N, int M, double maf)
         _genet_dst[j]=0.0;
         _allele1[j]="A";
         _allele2[j]="G";
-        _snp_1[j].resize(N);
-        _snp_2[j].resize(N);
 		std::tr1::uniform_real<double> runiform(maf,1-maf);
         double p = runiform(eng)/1.0e10;
 		
@@ -702,12 +700,9 @@ void gcta::simu_geno_unlinked(int N, int M, double maf)
 			cout<<x<<"\t";
 			
 			
-            if(x==2) _snp_1[j][i]=_snp_2[j][i]=true;
-            else if(x==1){
-                _snp_1[j][i]=false;
-                _snp_2[j][i]=true;
-            }
-            else _snp_1[j][i]=_snp_2[j][i]=false;
+            if(x==2) _geno.set(j, i, 0);
+            else if(x==1) _geno.set(j, i, 2);
+            else _geno.set(j, i, 3);
         }  
 		
 		//debug
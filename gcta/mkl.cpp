@@ -11,6 +11,7 @@
  */
 
 #include "gcta.h"
+#include "GenoDecode.h"
 
 /////////////////
 // data functions
@@ -22,9 +23,9 @@ void gcta::make_XMat_mkl(float *X)
 	cout<<"Recoding genotypes (individual major mode) ..."<<endl;
 	unsigned long i=0, j=0, k=0, n=_keep.size(), m=_include.size();
 
-    #pragma omp parallel for private(j)
-    for(i=0; i<n; i++){
-        if(_dosage_flag){
+    if(_dosage_flag){
+        #pragma omp parallel for private(j)
+        for(i=0; i<n; i++){
             for(j=0; j<m; j++){
                 if(_geno_dose[_keep[i]][_include[j]]<1e5){
                     if(_allele1[_include[j]]==_ref_A[_include[j]]) X[i*m+j]=_geno_dose[_keep[i]][_include[j]];
@@ -34,13 +35,17 @@ void gcta::make_XMat_mkl(float *X)
             }
             _geno_dose[i].clear();
         }
-        else{
-            for(j=0; j<_include.size(); j++){
-                if(!_snp_1[_include[j]][_keep[i]] || _snp_2[_include[j]][_keep[i]]){
-                    if(_allele1[_include[j]]==_ref_A[_include[j]]) X[i*m+j]=_snp_1[_include[j]][_keep[i]]+_snp_2[_include[j]][_keep[i]];
-                    else X[i*m+j]=2.0-(_snp_1[_include[j]][_keep[i]]+_snp_2[_include[j]][_keep[i]]);
-                }
-                else X[i*m+j]=1e6;
+    }
+    else{
+        #pragma omp parallel private(i)
+        {
+            float val[4];
+            vector<float> x(n);
+            #pragma omp for
+            for(j=0; j<m; j++){
+                geno_val(j, val, 1e6);
+                _geno.get_snp(_include[j], _keep, val, &x[0]);
+                for(i=0; i<n; i++) X[i*m+j]=x[i];
             }
         }
     }
@@ -50,7 +55,7 @@ void gcta::std_XMat_mkl(float *X, vector<double> &sd_SNP, bool grm_xchr_flag, bo
 {
 	if(_mu.empty()) calcu_mu();
 	
-    unsigned long i=0, j=0, k=0, n=_keep.size(), m=_include.size();
+    unsigned long i=0, j=0, n=_keep.size(), m=_include.size();
 	sd_SNP.clear();
     sd_SNP.resize(m);
     if(_dosage_flag){
@@ -72,34 +77,42 @@ void gcta::std_XMat_mkl(float *X, vector<double> &sd_SNP, bool grm_xchr_flag, bo
             else sd_SNP[j]=sqrt(1.0/sd_SNP[j]);
         }        
     }
+	if(grm_xchr_flag) check_sex();
     
-	#pragma omp parallel for private(j, k)
-    for(i=0; i<n; i++){
-		for(j=0; j<m; j++){
-			k=i*m+j;
-            if(X[k]<1e5){
-                X[k]-=_mu[_include[j]];
-                if(divid_by_std) X[k]*=sd_SNP[j];
-            }
-            else if(miss_with_mu) X[k]=0.0;
-		}
-	}
-	
-	if(!grm_xchr_flag) return;
-	// for the X-chromosome
-	check_sex();
-	double f_buf=sqrt(0.5);
-	
-	#pragma omp parallel for private(j, k)
-    for(i=0; i<n; i++){
-        if(_sex[_keep[i]]==1){
-            for(j=0; j<m; j++){
-				k=i*m+j;
-                if(X[k]<1e5) X[k]*=f_buf;
-                else if(miss_with_mu) X[k]=0.0;
-            }
+	#pragma omp parallel for
+    for(j=0; j<m; j++) std_snp_mkl(j, X+j, n, m, sd_SNP[j], grm_xchr_flag, miss_with_mu, divid_by_std);
+}
+
+void gcta::std_snp_mkl(unsigned long j, float *x, unsigned long num, unsigned long inc, double sd, bool grm_xchr_flag, bool miss_with_mu, bool divid_by_std)
+{
+    // genotypes x[i*inc] of the first num individuals at the j-th included SNP standardised in place: x-mu, multiplied by sd
+    // if divid_by_std and by sqrt(0.5) for the males on the X-chromosome; missing genotypes (1e6) are set to zero if miss_with_mu
+    unsigned long i=0;
+    double mu=_mu[_include[j]], f_buf=sqrt(0.5);
+    for(i=0; i<num; i++, x+=inc){
+        if(*x<1e5){
+            *x-=mu;
+            if(divid_by_std) *x*=sd;
+            if(grm_xchr_flag && _sex[_keep[i]]==1) *x*=f_buf;
         }
-	}
+        else if(miss_with_mu) *x=0.0;
+    }
+}
+
+void gcta::std_geno_block(unsigned long j_start, unsigned long j_end, float *X)
+{
+    // standardised genotypes of the included SNPs j_start to j_end-1, SNP major (n x (j_end-j_start), missing genotypes set to zero)
+    unsigned long j=0, n=_keep.size();
+    #pragma omp parallel for
+    for(j=j_start; j<j_end; j++){
+        float val[4], *x=X+(j-j_start)*n;
+        double sd=_mu[_include[j]]*(1.0-0.5*_mu[_include[j]]);
+        if(fabs(sd)<1.0e-50) sd=0.0;
+        else sd=sqrt(1.0/sd);
+        geno_val(j, val, 1e6);
+        _geno.get_snp(geno_snp(j), geno_keep(), val, x);
+        std_snp_mkl(j, x, n, 1, sd, false, true, true);
+    }
 }
 
 /////////////////
@@ -110,6 +123,17 @@ void gcta::make_grm_mkl(bool grm_xchr_flag, bool inbred, bool output_bin, int gr
 	if(grm_xchr_flag) check_chrX();
 	else check_autosome();
 	
+    if(!mlmassoc && !_dosage_flag){
+        // the popcount kernel is only faster than SGEMM with a hardware popcount
+        if(grm_mtd==1 && !diag_f3_flag && GenoDecode::fast_popcount()){
+            make_grm_int(grm_xchr_flag, inbred, output_bin);
+            return;
+        }
+        // the same accumulation as with --make-grm-block, so that both give the same GRM
+        make_grm_stream(grm_xchr_flag, inbred, output_bin, grm_mtd, diag_f3_flag, vector<int>(), vector<string>());
+        return;
+    }
+
 	unsigned long i=0, j=0, k=0, l=0, n=_keep.size(), m=_include.size();
 	_geno_mkl=new float[n*m]; // alloc memory to X matrix
 	
@@ -120,32 +144,38 @@ void gcta::make_grm_mkl(bool grm_xchr_flag, bool inbred, bool output_bin, int gr
 	
     if(!mlmassoc) cout<<"\nCalculating the genetic relationship matrix (GRM)"<<(grm_xchr_flag?" for the X chromosome":"")<<(_dosage_flag?" using imputed dosage data":"")<<" ... (Note: default speed-optimized mode, may use huge RAM)"<<endl;
     else cout<<"\nCalculating the genetic relationship matrix (GRM) ... "<<endl;
+    unsigned long r_start=0, r_end=0, t_start=0;
+    grm_part_range(n, r_start, r_end);
+    t_start=r_start*(r_start+1)/2;
     
-    // count the number of missing genotypes
-    vector< vector<int> > miss_pos(n);
-	bool * X_bool = new bool[n*m];
+    // count the number of missing genotypes, one bitset of SNPs per individual
+    unsigned long word_num=(m+63)/64;
+    uint64_t *miss_bits=new uint64_t[n*word_num];
+    vector<int> miss_num(n), miss_indi;
+    #pragma omp parallel for private(j, k)
     for(i=0; i<n; i++){
+        uint64_t *p=miss_bits+i*word_num;
+        for(j=0; j<word_num; j++) p[j]=0;
         for(j=0; j<m; j++){
             k=i*m+j;
-            if(_geno_mkl[k]<1e5) X_bool[k]=true;
-            else{
+            if(_geno_mkl[k]>=1e5){
                 _geno_mkl[k]=0.0;
-                miss_pos[i].push_back(j);
-                X_bool[k]=false;
+                p[j>>6]|=1ULL<<(j&63);
+                miss_num[i]++;
             }
         }
     }
+    for(i=0; i<n; i++){
+        if(miss_num[i]>0) miss_indi.push_back(i);
+    }
     
-    // Calculate A_N matrix
-	vector< vector<float> > A_N(n);
-	for(i=0; i<n; i++) A_N[i].resize(n);
+    // Calculate A_N matrix (lower triangle, packed by row)
+	vector<float> A_N(r_end*(r_end+1)/2-t_start);
+    count_miss_pair(miss_bits, word_num, miss_indi, r_start, r_end, A_N);
+    delete[] miss_bits;
     #pragma omp parallel for private(j, k)
-	for(i=0; i<n; i++){
-		for(j=0; j<=i; j++){
-			int comm=0;
-			for(k=0; k<miss_pos[j].size(); k++) comm+=(int)X_bool[i*m+miss_pos[j][k]];
-			A_N[i][j]=m-miss_pos[i].size()-comm;
-		}
+	for(i=r_start; i<r_end; i++){
+		for(j=0, k=i*(i+1)/2-t_start; j<=i; j++, k++) A_N[k]=m-miss_num[i]-(miss_num[j]-(int)A_N[k]);
 	}
     
     // Calculate sum of LD weights
@@ -156,20 +186,20 @@ void gcta::make_grm_mkl(bool grm_xchr_flag, bool inbred, bool output_bin, int gr
     }
     if(CommFunc::FloatEqual(sum_wt, 0.0)) throw("Error: the sum of the weights is zero!");
     
-    #pragma omp parallel for private(j, k)
-    for(i=0; i<n; i++){
-        for(j=0; j<=i; j++) A_N[i][j]=A_N[i][j]*sum_wt/d_m;
-    }
+    #pragma omp parallel for
+    for(k=0; k<A_N.size(); k++) A_N[k]=A_N[k]*sum_wt/d_m;
 	
-    // Calcuate WW'
-	_grm_mkl=new float[n*n]; // alloc memory to A
-	cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, n, n, m, 1.0, _geno_mkl, m, _geno_mkl, m, 0.0, _grm_mkl, n);
+    // Calcuate WW' (lower triangle, packed by row)
+	_grm_mkl=new float[A_N.size()]; // alloc memory to A
+	vector<unsigned long> c_pos(2);
+    c_pos[1]=m;
+	syrk_packed(_geno_mkl, c_pos, r_start, r_end, _grm_mkl, false);
     
     // re-calcuate the diagonals (Fhat3+1)
     if(diag_f3_flag){
         #pragma omp parallel for private(j,k,l)
-        for(i=0; i<n; i++){
-            l=i*n+i;
+        for(i=r_start; i<r_end; i++){
+            l=i*(i+1)/2+i-t_start;
             _grm_mkl[l]=0.0;
             for(j=0; j<m; j++){
                 k=i*m+j;
@@ -179,19 +209,11 @@ void gcta::make_grm_mkl(bool grm_xchr_flag, bool inbred, bool output_bin, int gr
     }
     
     // Calculate A matrix
-    #pragma omp parallel for private(j)
-    for(i=0; i<n; i++){
-        for(j=0; j<=i; j++){
-            if(A_N[i][j]>0.0) _grm_mkl[i*n+j]/=A_N[i][j];
-            else _grm_mkl[i*n+j]=0.0;
-        }
-    }
-      
-    if(inbred){
-        #pragma omp parallel for private(j)
-        for(i=0; i<n; i++){
-            for(j=0; j<=i; j++) _grm_mkl[i*n+j]*=0.5;
-        }
+    #pragma omp parallel for
+    for(k=0; k<A_N.size(); k++){
+        if(A_N[k]>0.0) _grm_mkl[k]/=A_N[k];
+        else _grm_mkl[k]=0.0;
+        if(inbred) _grm_mkl[k]*=0.5;
     }
     
     if(mlmassoc && grm_mtd==0){
@@ -207,68 +229,913 @@ void gcta::make_grm_mkl(bool grm_xchr_flag, bool inbred, bool output_bin, int gr
                 else _geno_mkl[k]=0.0;
             }
         }
-        delete[] X_bool;
     }
 	else{
         // Output A_N and A
-        string out_buf=_out;
         output_grm_mkl(_grm_mkl, A_N, output_bin);
-        _out=out_buf;
         
         // free memory
         delete[] _geno_mkl;
-        delete[] X_bool;
         delete[] _grm_mkl;
     }
 }
 
-void gcta::output_grm_mkl(float* A, vector< vector<float> > &A_N, bool output_grm_bin)
+void gcta::make_mgrm(bool inbred, bool output_bin, int grm_mtd, bool diag_f3_flag, bool chr_flag, vector<double> maf_bin, string snp_grp_file)
+{
+    // one GRM per chromosome, MAF bin or group of SNPs in snp_grp_file (e.g. LD-stratified), in a single pass over the genotypes
+    check_autosome();
+    unsigned long j=0, k=0;
+    vector<int> snp_grp;
+    vector<string> grp_name;
+    map<string, int> grp_map;
+    map<string, int>::iterator iter;
+    stringstream ss;
+    if(chr_flag){
+        for(j=0; j<_include.size(); j++){
+            ss.str("");
+            ss<<"chr"<<_chr[_include[j]];
+            iter=grp_map.find(ss.str());
+            if(iter==grp_map.end()){
+                grp_map.insert(pair<string, int>(ss.str(), grp_name.size()));
+                snp_grp.push_back(grp_name.size());
+                grp_name.push_back(ss.str());
+            }
+            else snp_grp.push_back(iter->second);
+        }
+    }
+    else if(!maf_bin.empty()){
+        if(_mu.empty()) calcu_mu();
+        maf_bin.insert(maf_bin.begin(), 0.0);
+        maf_bin.push_back(0.5);
+        for(k=0; k+1<maf_bin.size(); k++){
+            ss.str("");
+            ss<<"maf"<<maf_bin[k]<<"-"<<maf_bin[k+1];
+            grp_name.push_back(ss.str());
+        }
+        for(j=0; j<_include.size(); j++){
+            double fbuf=0.5*_mu[_include[j]];
+            if(fbuf>0.5) fbuf=1.0-fbuf;
+            k=upper_bound(maf_bin.begin()+1, maf_bin.end()-1, fbuf)-maf_bin.begin()-1;
+            snp_grp.push_back(k);
+        }
+    }
+    else{
+        ifstream i_grp(snp_grp_file.c_str());
+        if(!i_grp) throw("Error: can not open the file ["+snp_grp_file+"] to read.");
+        cout<<"Reading the SNP groups from ["+snp_grp_file+"]."<<endl;
+        string snp_buf, grp_buf, str_buf;
+        vector<string> snplist;
+        map<string, int> snp_grp_map;
+        while(i_grp>>snp_buf){
+            if(!(i_grp>>grp_buf)) throw("Error: in the file ["+snp_grp_file+"]. Each line should have a SNP and a group name.");
+            getline(i_grp, str_buf);
+            iter=grp_map.find(grp_buf);
+            if(iter==grp_map.end()){
+                iter=grp_map.insert(pair<string, int>(grp_buf, grp_name.size())).first;
+                grp_name.push_back(grp_buf);
+            }
+            if(!snp_grp_map.insert(pair<string, int>(snp_buf, iter->second)).second) throw("Error: the SNP ["+snp_buf+"] appears more than once in the file ["+snp_grp_file+"].");
+            snplist.push_back(snp_buf);
+        }
+        i_grp.close();
+        update_id_map_kp(snplist, _snp_name_map, _include);
+        cout<<_include.size()<<" SNPs in "<<grp_name.size()<<" groups are included from ["+snp_grp_file+"]."<<endl;
+        for(j=0; j<_include.size(); j++) snp_grp.push_back(snp_grp_map[_snp_name[_include[j]]]);
+    }
+    if(_include.empty()) throw("Error: no SNP is included in the analysis.");
+
+    // drop the groups without SNPs
+    vector<int> grp_m(grp_name.size()), grp_indx(grp_name.size(), -1);
+    vector<string> grp_name_buf;
+    for(j=0; j<snp_grp.size(); j++) grp_m[snp_grp[j]]++;
+    for(k=0; k<grp_name.size(); k++){
+        if(grp_m[k]==0){
+            cout<<"Warning: there is no SNP in group ["<<grp_name[k]<<"]. The GRM is not calculated for this group."<<endl;
+            continue;
+        }
+        cout<<grp_m[k]<<" SNPs in group ["<<grp_name[k]<<"]."<<endl;
+        grp_indx[k]=grp_name_buf.size();
+        grp_name_buf.push_back(grp_name[k]);
+    }
+    for(j=0; j<snp_grp.size(); j++) snp_grp[j]=grp_indx[snp_grp[j]];
+    grp_name.swap(grp_name_buf);
+
+    make_grm_stream(false, inbred, output_bin, grm_mtd, diag_f3_flag, snp_grp, grp_name);
+
+    // the list of GRMs for --mgrm
+    string mgrm_file=_out+".mgrm";
+    ofstream o_mgrm(mgrm_file.c_str());
+    if(!o_mgrm) throw("Error: can not open the file ["+mgrm_file+"] to write.");
+    for(k=0; k<grp_name.size(); k++) o_mgrm<<_out+"."+grp_name[k]<<endl;
+    o_mgrm.close();
+    cout<<"The list of the "<<grp_name.size()<<" GRMs has been saved in the file ["+mgrm_file+"] (for the option --mgrm"<<(_grm_cbin_type>-1?"-cbin":(output_bin?"":"-gz"))<<")."<<endl;
+}
+
+void gcta::make_grm_stream(bool grm_xchr_flag, bool inbred, bool output_bin, int grm_mtd, bool diag_f3_flag, const vector<int> &snp_grp, const vector<string> &grp_name)
+{
+    // one GRM per SNP group (snp_grp[j] for the j-th included SNP, all SNPs in one group if snp_grp is empty),
+    // accumulated in a single pass over the genotypes. The genotypes are read block by block with --make-grm-block,
+    // otherwise they are already in memory and only the standardised genotypes are built in blocks.
+    // WW' is summed over chunks of c_size SNPs in the same order whatever the block size, the blocks being
+    // multiples of c_size, so that the GRM does not depend on --make-grm-block
+	unsigned long i=0, j=0, k=0, t=0, n=_keep.size(), m=_include.size(), b=0, j_start=0, j_end=0, c_start=0, p=0;
+    unsigned long grp_num=(snp_grp.empty()?1:grp_name.size()), c_size=1024, blk=0;
+    if(_geno_block>0) blk=(_geno_block+c_size-1)/c_size*c_size;
+    else blk=(grp_num>1?c_size:m);
+    bool mu_flag=_mu.empty();
+    if(mu_flag) _mu.resize(_snp_num);
+    if(grm_xchr_flag) check_sex();
+
+    if(grp_num>1) cout<<"\nCalculating "<<grp_num<<" genetic relationship matrices (GRMs) in one pass over the genotypes, in blocks of "<<blk<<" SNPs ..."<<endl;
+    else if(_geno_block>0) cout<<"\nCalculating the genetic relationship matrix (GRM)"<<(grm_xchr_flag?" for the X chromosome":"")<<" in blocks of "<<blk<<" SNPs ..."<<endl;
+    else cout<<"\nCalculating the genetic relationship matrix (GRM)"<<(grm_xchr_flag?" for the X chromosome":"")<<" ... (Note: default speed-optimized mode, may use huge RAM)"<<endl;
+    unsigned long r_start=0, r_end=0, t_start=0;
+    grm_part_range(n, r_start, r_end);
+    t_start=r_start*(r_start+1)/2;
+
+    // the individuals after the last row of the GRM part are not needed
+    float *X=new float[r_end*blk];
+    unsigned long word_num=0;
+    uint64_t *miss_bits=new uint64_t[r_end*((blk+63)/64)];
+    vector<float *> grm(grp_num);
+	vector< vector<float> > A_N(grp_num), diag_f3(grp_num);
+    vector< vector<int> > miss_num(grp_num);
+    vector<int> miss_indi, col;
+    vector<unsigned long> grp_m(grp_num), c_pos, x_off(blk), x_ld(blk);
+    vector<long double> sum_wt(grp_num);
+    vector<double> sd_SNP(blk);
+    for(p=0; p<grp_num; p++){
+        A_N[p].resize(r_end*(r_end+1)/2-t_start);
+        grm[p]=new float[A_N[p].size()];
+        miss_num[p].resize(n);
+        if(diag_f3_flag) diag_f3[p].resize(n);
+    }
+    for(j_start=0; j_start<m; j_start=j_end){
+        j_end=j_start+blk;
+        if(j_end>m) j_end=m;
+        if(_geno_block>0) load_geno_block(j_start, j_end);
+        if(mu_flag) calcu_mu_block(j_start, j_end);
+
+        for(p=0; p<grp_num; p++){
+            // columns of this group in the block, cut at the chunks
+            col.clear();
+            c_pos.assign(1, 0);
+            for(c_start=j_start; c_start<j_end; c_start+=c_size){
+                for(j=c_start; j<c_start+c_size && j<j_end; j++){
+                    if(snp_grp.empty() || snp_grp[j]==p) col.push_back(j);
+                }
+                if(col.size()>c_pos.back()) c_pos.push_back(col.size());
+            }
+            b=col.size();
+            if(b==0) continue;
+
+            // X holds the chunks one after the other, each r_end x (number of its columns)
+            for(t=0; t+1<c_pos.size(); t++){
+                for(j=c_pos[t]; j<c_pos[t+1]; j++){
+                    x_off[j]=r_end*c_pos[t]+j-c_pos[t];
+                    x_ld[j]=c_pos[t+1]-c_pos[t];
+                }
+            }
+
+            // standardise the genotypes of this group in the block
+            for(j=0; j<b; j++){
+                sd_SNP[j]=_mu[_include[col[j]]]*(1.0-0.5*_mu[_include[col[j]]]);
+                if(grm_mtd==1) sum_wt[p]+=sd_SNP[j];
+                else{
+                    if(fabs(sd_SNP[j])<1.0e-50) sd_SNP[j]=0.0;
+                    else sd_SNP[j]=sqrt(1.0/sd_SNP[j]);
+                }
+            }
+            #pragma omp parallel private(i)
+            {
+                float val[4];
+                vector<float> x(n);
+                #pragma omp for
+                for(j=0; j<b; j++){
+                    geno_val(col[j], val, 1e6);
+                    _geno.get_snp(geno_snp(col[j]), geno_keep(), val, &x[0]);
+                    for(i=0; i<r_end; i++) X[x_off[j]+i*x_ld[j]]=x[i];
+                    std_snp_mkl(col[j], X+x_off[j], r_end, x_ld[j], sd_SNP[j], grm_xchr_flag, false, grm_mtd==0);
+                }
+            }
+
+            // missing genotypes are set to zero and recorded in one bitset per individual
+            word_num=(b+63)/64;
+            #pragma omp parallel for private(j, k)
+            for(i=0; i<r_end; i++){
+                uint64_t *q=miss_bits+i*word_num;
+                for(j=0; j<word_num; j++) q[j]=0;
+                for(j=0; j<b; j++){
+                    k=x_off[j]+i*x_ld[j];
+                    if(X[k]>=1e5){
+                        X[k]=0.0;
+                        q[j>>6]|=1ULL<<(j&63);
+                        miss_num[p][i]++;
+                    }
+                }
+            }
+
+            // count the number of SNPs missing in both individuals of a pair
+            miss_indi.clear();
+            for(i=0; i<r_end; i++){
+                for(j=0; j<word_num; j++){
+                    if(miss_bits[i*word_num+j]!=0){
+                        miss_indi.push_back(i);
+                        break;
+                    }
+                }
+            }
+            count_miss_pair(miss_bits, word_num, miss_indi, r_start, r_end, A_N[p]);
+
+            // accumulate WW'
+            syrk_packed(X, c_pos, r_start, r_end, grm[p], grp_m[p]>0);
+            grp_m[p]+=b;
+
+            // diagonals (Fhat3+1)
+            if(diag_f3_flag){
+                #pragma omp parallel for private(j, k)
+                for(i=r_start; i<r_end; i++){
+                    for(j=0; j<b; j++){
+                        k=x_off[j]+i*x_ld[j];
+                        diag_f3[p][i]+=X[k]*(X[k]+(_mu[_include[col[j]]]-1.0)*sd_SNP[j]);
+                    }
+                }
+            }
+        }
+    }
+    delete[] X;
+    delete[] miss_bits;
+    if(_geno_block>0) _geno.clear();
+
+    for(p=0; p<grp_num; p++){
+        long double d_m=(double)grp_m[p];
+        if(grm_mtd==0) sum_wt[p]=d_m;
+        if(CommFunc::FloatEqual(sum_wt[p], 0.0)) throw("Error: the sum of the weights is zero!");
+
+        // Calculate A_N and A matrices
+        float *A=grm[p];
+        #pragma omp parallel for private(j, k)
+        for(i=r_start; i<r_end; i++){
+            if(diag_f3_flag) A[i*(i+1)/2+i-t_start]=diag_f3[p][i];
+            for(j=0, k=i*(i+1)/2-t_start; j<=i; j++, k++){
+                A_N[p][k]=grp_m[p]-miss_num[p][i]-(miss_num[p][j]-(int)A_N[p][k]);
+                A_N[p][k]=A_N[p][k]*sum_wt[p]/d_m;
+                if(A_N[p][k]>0.0) A[k]/=A_N[p][k];
+                else A[k]=0.0;
+                if(inbred) A[k]*=0.5;
+            }
+        }
+
+        _grm_mkl=A;
+        if(grp_name.empty()) output_grm_mkl(_grm_mkl, A_N[p], output_bin);
+        else{
+            cout<<"GRM of the "<<grp_m[p]<<" SNPs in group ["<<grp_name[p]<<"]:"<<endl;
+            output_grm_mkl(_grm_mkl, A_N[p], output_bin, grp_name[p]);
+        }
+        delete[] grm[p];
+        vector<float>().swap(A_N[p]);
+    }
+}
+
+void gcta::make_grm_int(bool grm_xchr_flag, bool inbred, bool output_bin)
+{
+    // GRM without the SNP weights (--make-grm-alg 1) from hard-called genotypes. For individuals i and j,
+    // sum_k (x_ik-2p_k)(x_jk-2p_k) over the SNPs non-missing in both is expanded into sum_k x_ik*x_jk, counted
+    // exactly with popcounts over bit planes of the dosages, the per-individual sums a_i=sum_k 2p_k*x_ik and
+    // q_i=sum_k (2p_k)^2 over the missing SNPs of i, and r_ij+r_ji with r_ij=sum_k v_k(x_ik) over the missing
+    // SNPs of j, where v_k(x)=2p_k*x if x is non-missing and (2p_k)^2/2 otherwise.
+    // The SNPs are taken in chunks of c_size, and x_ik*x_jk+r_ij+r_ji of each pair is summed up chunk by chunk
+    // into a single double. With --make-grm-block the genotypes are read in blocks of whole chunks and that partial
+    // sum is carried over from block to block, so that the GRM does not depend on --make-grm-block
+    if(grm_xchr_flag) check_sex();
+
+	unsigned long i=0, j=0, k=0, l=0, n=_keep.size(), m=_include.size(), r_start=0, r_end=0, t_start=0;
+    unsigned long c_size=1024, c_start=0, c_end=0, w_c=0, blk=(_geno_block>0?(_geno_block+c_size-1)/c_size*c_size:m), b_start=0, b_end=0, nb=0, word_num=0;
+    bool mu_flag=_mu.empty(), last=false;
+    if(mu_flag) _mu.resize(_snp_num);
+    cout<<"\nCalculating the genetic relationship matrix (GRM)"<<(grm_xchr_flag?" for the X chromosome":"")<<" from the genotype bit planes";
+    if(blk<m) cout<<" in blocks of "<<blk<<" SNPs";
+    cout<<" ..."<<endl;
+    grm_part_range(n, r_start, r_end);
+    t_start=r_start*(r_start+1)/2;
+
+    // sums over the SNPs: per individual, per pair (carried over from block to block if there is more than one) and overall
+    vector<double> a(r_end), q(r_end), f(r_end);
+    for(i=0; i<r_end; i++) f[i]=(grm_xchr_flag && _sex[_keep[i]]==1)?sqrt(0.5):1.0;
+	vector<float> A_N(r_end*(r_end+1)/2-t_start);
+    vector<double> r_sum;
+    if(blk<m) r_sum.resize(A_N.size());
+    long double c=0.0, sum_wt=0.0, d_m=(double)m;
+	_grm_mkl=new float[A_N.size()];
+
+    // pairs of individuals in square tiles
+    unsigned long t_size=128;
+    vector<unsigned long> ti, tj;
+    for(i=r_start/t_size*t_size; i<r_end; i+=t_size){
+        for(j=0; j<=i; j+=t_size){
+            ti.push_back(i);
+            tj.push_back(j);
+        }
+    }
+
+    GenoStore geno_kp;
+    vector<int> kp;
+    if(_geno_block==0 && n<_indi_num) kp.assign(_keep.begin(), _keep.begin()+r_end);
+    vector<const unsigned char *> snp_code(blk);
+    vector<double> mu(blk), v(blk*4);
+    vector< vector<int> > miss_pos(r_end);
+    // bit planes of the block, chunk by chunk: the 3 planes of individual i in chunk c are at G+c*r_end*3*c_size/64+i*3*w_c
+    uint64_t *G=new uint64_t[r_end*3*((blk+63)/64)];
+    for(b_start=0; b_start<m; b_start=b_end){
+        b_end=min(b_start+blk, m);
+        nb=b_end-b_start;
+        word_num=(nb+63)/64;
+        last=(b_end==m);
+        if(_geno_block>0) load_geno_block(b_start, b_end);
+        if(mu_flag) calcu_mu_block(b_start, b_end);
+
+        // genotypes of the individuals in _keep, SNP-major
+        if(!kp.empty()) geno_kp.init(nb, r_end);
+        #pragma omp parallel for
+        for(k=0; k<nb; k++){
+            if(kp.empty()) snp_code[k]=(const unsigned char *)_geno.snp_ptr(geno_snp(b_start+k));
+            else{
+                geno_kp.read_bed_snp(k, (const unsigned char *)_geno.snp_ptr(_include[b_start+k]), _indi_num, kp);
+                snp_code[k]=(const unsigned char *)geno_kp.snp_ptr(k);
+            }
+        }
+
+        // v_k for each genotype code
+        for(k=0; k<nb; k++){
+            mu[k]=_mu[_include[b_start+k]];
+            geno_val(b_start+k, &v[k*4], 0.5*mu[k]);
+            for(l=0; l<4; l++) v[k*4+l]*=mu[k];
+            c+=mu[k]*mu[k];
+            sum_wt+=mu[k]*(1.0-0.5*mu[k]);
+        }
+
+        // bit planes of the dosage of the reference allele for each individual: dosage 1, dosage 2 and non-missing
+        #pragma omp parallel for private(i, k, l)
+        for(j=0; j<word_num; j++){
+            unsigned long j_c=j/(c_size/64)*(c_size/64), n_c=min((j_c+c_size/64)*64, nb)-j_c*64, wj=j-j_c;
+            uint64_t *Gc=G+j_c*r_end*3;
+            n_c=(n_c+63)/64;
+            for(i=0; i<r_end; i++) Gc[i*3*n_c+wj]=Gc[(i*3+1)*n_c+wj]=Gc[(i*3+2)*n_c+wj]=0;
+            for(k=j*64; k<(j+1)*64 && k<nb; k++){
+                bool flip=(_allele1[_include[b_start+k]]!=_ref_A[_include[b_start+k]]);
+                uint64_t bit=1ULL<<(k&63);
+                for(i=0; i<r_end; i++){
+                    l=(snp_code[k][i>>2]>>((i&3)<<1))&3;
+                    if(GenoStore::miss(l)) continue;
+                    l=GenoStore::dose(l);
+                    if(flip) l=2-l;
+                    if(l>0) Gc[(i*3+l-1)*n_c+wj]|=bit;
+                    Gc[(i*3+2)*n_c+wj]|=bit;
+                }
+            }
+        }
+
+        // a_i, q_i and the missing SNPs of each individual in the block
+        #pragma omp parallel for private(k, c_start, c_end, w_c)
+        for(i=0; i<r_end; i++){
+            miss_pos[i].clear();
+            for(c_start=0; c_start<nb; c_start=c_end){
+                c_end=min(c_start+c_size, nb);
+                w_c=(c_end-c_start+63)/64;
+                const uint64_t *g=G+c_start/64*r_end*3+i*3*w_c;
+                for(k=c_start; k<c_end; k++){
+                    unsigned long w=(k-c_start)>>6;
+                    if((g[2*w_c+w]>>(k&63))&1) a[i]+=mu[k]*(double)(((g[w]>>(k&63))&1)+2*((g[w_c+w]>>(k&63))&1));
+                    else{
+                        miss_pos[i].push_back(k);
+                        q[i]+=mu[k]*mu[k];
+                    }
+                }
+            }
+        }
+
+        #pragma omp parallel for schedule(dynamic) private(i, j, k, c_start, c_end, w_c)
+        for(l=0; l<ti.size(); l++){
+            unsigned long i_start=max(ti[l], r_start), i_end=min(ti[l]+t_size, r_end), j_end=min(tj[l]+t_size, r_end);
+            vector<double> R(t_size*t_size), r_a(t_size*t_size), r_b(t_size*t_size);
+            vector<int>::const_iterator p;
+            bool r_flag=false;
+
+            // partial sums of the pairs from the previous blocks
+            if(b_start>0){
+                for(i=i_start; i<i_end; i++){
+                    for(j=tj[l]; j<j_end && j<=i; j++) R[(i-ti[l])*t_size+j-tj[l]]=r_sum[i*(i+1)/2+j-t_start];
+                }
+            }
+            for(c_start=0; c_start<nb; c_start=c_end){
+                c_end=min(c_start+c_size, nb);
+                w_c=(c_end-c_start+63)/64;
+                const uint64_t *Gc=G+c_start/64*r_end*3;
+
+                // r_ji over the missing SNPs of i, and r_ij over the missing SNPs of j, in the chunk
+                if(r_flag){
+                    fill(r_a.begin(), r_a.end(), 0.0);
+                    fill(r_b.begin(), r_b.end(), 0.0);
+                    r_flag=false;
+                }
+                for(i=i_start; i<i_end; i++){
+                    for(p=lower_bound(miss_pos[i].begin(), miss_pos[i].end(), (int)c_start); p!=miss_pos[i].end() && *p<(int)c_end; p++, r_flag=true) GenoDecode::add_value(snp_code[*p]+tj[l]/4, j_end-tj[l], &v[*p*4], &r_a[(i-ti[l])*t_size]);
+                }
+                for(j=tj[l]; j<j_end; j++){
+                    for(p=lower_bound(miss_pos[j].begin(), miss_pos[j].end(), (int)c_start); p!=miss_pos[j].end() && *p<(int)c_end; p++, r_flag=true) GenoDecode::add_value(snp_code[*p]+ti[l]/4, i_end-ti[l], &v[*p*4], &r_b[(j-tj[l])*t_size]);
+                }
+
+                for(i=i_start; i<i_end; i++){
+                    const uint64_t *g_i=Gc+i*3*w_c;
+                    for(j=tj[l]; j<j_end && j<=i; j++){
+                        int both=0, xx=GenoDecode::dose_product(g_i, Gc+j*3*w_c, w_c, both);
+                        R[(i-ti[l])*t_size+j-tj[l]]+=xx+r_a[(i-ti[l])*t_size+j-tj[l]]+r_b[(j-tj[l])*t_size+i-ti[l]];
+                        A_N[i*(i+1)/2+j-t_start]+=both;
+                    }
+                }
+            }
+
+            for(i=i_start; i<i_end; i++){
+                for(j=tj[l]; j<j_end && j<=i; j++){
+                    k=i*(i+1)/2+j-t_start;
+                    if(!last){
+                        r_sum[k]=R[(i-ti[l])*t_size+j-tj[l]];
+                        continue;
+                    }
+                    A_N[k]=A_N[k]*sum_wt/d_m;
+                    if(A_N[k]>0.0) _grm_mkl[k]=(R[(i-ti[l])*t_size+j-tj[l]]-a[i]-a[j]+c-q[i]-q[j])*f[i]*f[j]/A_N[k];
+                    else _grm_mkl[k]=0.0;
+                    if(inbred) _grm_mkl[k]*=0.5;
+                }
+            }
+        }
+    }
+    delete[] G;
+    if(_geno_block>0) _geno.clear();
+    if(CommFunc::FloatEqual(sum_wt, 0.0)) throw("Error: the sum of the weights is zero!");
+
+    output_grm_mkl(_grm_mkl, A_N, output_bin);
+    delete[] _grm_mkl;
+}
+
+void gcta::make_grm_sparse(bool grm_xchr_flag, bool inbred, int grm_mtd, bool diag_f3_flag, double sp_cutoff)
+{
+    // sparse GRM: the pairs of individuals are taken in square tiles, each accumulated over blocks of SNPs, and only
+    // the diagonals and the pairs with a genetic relationship above sp_cutoff are kept, so that the dense GRM is
+    // never held in memory. Tiles of the same strip of rows are calculated in parallel and saved before the next strip
+    if(grm_xchr_flag) check_chrX();
+    else check_autosome();
+    if(_mu.empty()) calcu_mu();
+    if(grm_xchr_flag) check_sex();
+
+	unsigned long i=0, j=0, k=0, l=0, n=_keep.size(), m=_include.size(), t_size=512, blk=1024, i_start=0, i_end=0;
+    cout<<"\nCalculating the sparse genetic relationship matrix (GRM)"<<(grm_xchr_flag?" for the X chromosome":"")<<" with a cutoff of "<<sp_cutoff<<" ..."<<endl;
+
+    // genotypes of the individuals in _keep, SNP-major
+    GenoStore geno_kp;
+    vector<int> kp;
+    vector<const uint64_t *> snp_code(m);
+    if(n<_indi_num){
+        kp=_keep;
+        geno_kp.init(m, n);
+    }
+    #pragma omp parallel for
+    for(k=0; k<m; k++){
+        if(kp.empty()) snp_code[k]=_geno.snp_ptr(_include[k]);
+        else{
+            geno_kp.read_bed_snp(k, (const unsigned char *)_geno.snp_ptr(_include[k]), _indi_num, kp);
+            snp_code[k]=geno_kp.snp_ptr(k);
+        }
+    }
+
+    // standardised value of each genotype code, zero if missing
+    vector<float> val(m*4);
+    vector<double> sd_SNP(m), f3_fac(m);
+    long double sum_wt=0.0, d_m=(double)m;
+    for(k=0; k<m; k++){
+        double mu=_mu[_include[k]];
+        geno_val(k, &val[k*4], mu);
+        sd_SNP[k]=mu*(1.0-0.5*mu);
+        if(grm_mtd==1) sum_wt+=sd_SNP[k];
+        else{
+            if(fabs(sd_SNP[k])<1.0e-50) sd_SNP[k]=0.0;
+            else sd_SNP[k]=sqrt(1.0/sd_SNP[k]);
+        }
+        for(l=0; l<4; l++){
+            val[k*4+l]-=mu;
+            if(grm_mtd==0) val[k*4+l]*=sd_SNP[k];
+        }
+        f3_fac[k]=(mu-1.0)*sd_SNP[k];
+    }
+    if(grm_mtd==0) sum_wt=d_m;
+    if(CommFunc::FloatEqual(sum_wt, 0.0)) throw("Error: the sum of the weights is zero!");
+
+    // number of missing genotypes of each individual
+    vector<int> miss_num(n);
+    vector<float> f(n, 1.0);
+    #pragma omp parallel for private(i, k, l)
+    for(j=0; j<(n+63)/64; j++){
+        for(k=0; k<m; k++){
+            for(l=j*2; l<j*2+2 && l*32<n; l++){
+                uint64_t mm=GenoDecode::miss_mask(snp_code[k][l]);
+                while(mm){
+                    i=l*32+(__builtin_ctzll(mm)>>1);
+                    if(i<n) miss_num[i]++;
+                    mm&=mm-1;
+                }
+            }
+        }
+    }
+    if(grm_xchr_flag){
+        for(i=0; i<n; i++){
+            if(_sex[_keep[i]]==1) f[i]=sqrt(0.5);
+        }
+    }
+
+    // the same layout as .grm.gz, without the number of SNPs: row, column (1-based) and genetic relationship
+    string sp_file=_out+".grm.sp.gz";
+    gzofstream o_sp;
+    o_sp.open(sp_file.c_str());
+    if(!o_sp.is_open()) throw("Error: can not open the file ["+sp_file+"] to write.");
+    o_sp.setf(ios::scientific);
+    o_sp.precision(6);
+    unsigned long pair_num=0;
+    for(i_start=0; i_start<n; i_start=i_end){
+        i_end=min(i_start+t_size, n);
+        unsigned long t_num=i_start/t_size+1, ni=i_end-i_start;
+        vector< vector<int> > sp_col(t_num);
+        vector< vector<float> > sp_val(t_num);
+        vector< vector<unsigned long> > sp_row(t_num);
+
+        #pragma omp parallel for schedule(dynamic) private(i, j, k, l)
+        for(long t=t_num-1; t>=0; t--){
+            unsigned long j_start=t*t_size, j_end=min(j_start+t_size, n), nj=j_end-j_start, b_start=0, b_end=0, nb=0, w_num=blk/64, r=0, s=0;
+            bool diag_tile=(j_start==i_start);
+            vector<float> XI(blk*t_size), XJ(diag_tile?0:blk*t_size), C(t_size*t_size), diag(diag_tile?t_size:0);
+            vector<int> both(t_size*t_size);
+            vector<uint64_t> MI(t_size*w_num), MJ(diag_tile?0:t_size*w_num);
+            vector<char> any_i(t_size), any_j(t_size);
+            for(b_start=0; b_start<m; b_start=b_end){
+                b_end=min(b_start+blk, m);
+                nb=b_end-b_start;
+
+                // standardised genotypes of the block, SNP-major, and the missing genotypes as one bitset per individual
+                for(s=0; s<(diag_tile?1:2); s++){
+                    unsigned long r_start=(s==0?i_start:j_start), nr=(s==0?ni:nj);
+                    float *X=(s==0?&XI[0]:&XJ[0]);
+                    uint64_t *M=(s==0?&MI[0]:&MJ[0]);
+                    vector<char> &any=(s==0?any_i:any_j);
+                    for(r=0; r<nr*w_num; r++) M[r]=0;
+                    for(r=0; r<nr; r++) any[r]=0;
+                    for(k=b_start; k<b_end; k++){
+                        float *x=X+(k-b_start)*nr;
+                        GenoDecode::value((const unsigned char *)snp_code[k]+r_start/4, nr, &val[k*4], x);
+                        if(grm_xchr_flag){
+                            for(r=0; r<nr; r++) x[r]*=f[r_start+r];
+                        }
+                        for(l=r_start/32; l<(r_start+nr+31)/32; l++){
+                            uint64_t mm=GenoDecode::miss_mask(snp_code[k][l]);
+                            while(mm){
+                                r=l*32+(__builtin_ctzll(mm)>>1)-r_start;
+                                if(r<nr){
+                                    M[r*w_num+((k-b_start)>>6)]|=1ULL<<((k-b_start)&63);
+                                    any[r]=1;
+                                }
+                                mm&=mm-1;
+                            }
+                        }
+                    }
+                }
+                cblas_sgemm(CblasRowMajor, CblasTrans, CblasNoTrans, ni, nj, nb, 1.0, &XI[0], ni, diag_tile?&XI[0]:&XJ[0], nj, b_start>0?1.0:0.0, &C[0], nj);
+
+                // number of SNPs missing in both individuals of a pair
+                const uint64_t *MJ_p=(diag_tile?&MI[0]:&MJ[0]);
+                const vector<char> &any_J=(diag_tile?any_i:any_j);
+                for(i=0; i<ni; i++){
+                    if(!any_i[i]) continue;
+                    for(j=0; j<nj; j++){
+                        if(any_J[j]) both[i*nj+j]+=GenoDecode::and_count(&MI[i*w_num], MJ_p+j*w_num, (nb+63)/64);
+                    }
+                }
+
+                // diagonals (Fhat3+1)
+                if(diag_tile && diag_f3_flag){
+                    for(k=b_start; k<b_end; k++){
+                        const float *x=&XI[(k-b_start)*ni];
+                        for(i=0; i<ni; i++) diag[i]+=x[i]*(x[i]+f3_fac[k]);
+                    }
+                }
+            }
+
+            // keep the diagonals and the pairs above the cutoff
+            sp_row[t].resize(ni+1);
+            for(i=0; i<ni; i++){
+                sp_row[t][i]=sp_col[t].size();
+                for(j=0; j<nj && j_start+j<=i_start+i; j++){
+                    double a_n=(d_m-miss_num[i_start+i]-miss_num[j_start+j]+both[i*nj+j])*sum_wt/d_m, g=0.0;
+                    if(a_n>0.0) g=((diag_tile && i==j && diag_f3_flag)?diag[i]:C[i*nj+j])/a_n;
+                    if(inbred) g*=0.5;
+                    if(j_start+j==i_start+i || g>sp_cutoff){
+                        sp_col[t].push_back(j_start+j);
+                        sp_val[t].push_back(g);
+                    }
+                }
+            }
+            sp_row[t][ni]=sp_col[t].size();
+        }
+
+        // save the strip, each row sorted by column
+        for(i=0; i<ni; i++){
+            for(k=0; k<t_num; k++){
+                for(l=sp_row[k][i]; l<sp_row[k][i+1]; l++) o_sp<<i_start+i+1<<'\t'<<sp_col[k][l]+1<<'\t'<<sp_val[k][l]<<'\n';
+                pair_num+=sp_row[k][i+1]-sp_row[k][i];
+            }
+        }
+    }
+    o_sp.close();
+    cout<<"Sparse GRM of "<<n<<" individuals ("<<pair_num-n<<" pairs with a genetic relationship > "<<sp_cutoff<<") has been saved in the file ["+sp_file+"] (in compressed text format)."<<endl;
+
+	string famfile=_out+".grm.id";
+	ofstream Fam(famfile.c_str());
+	if(!Fam) throw("Error: can not open the file ["+famfile+"] to write.");
+	for(i=0; i<n; i++) Fam<<_fid[_keep[i]]+"\t"+_pid[_keep[i]]<<endl;
+	Fam.close();
+	cout<<"IDs for the GRM file ["+sp_file+"] have been saved in the file ["+famfile+"]."<<endl;
+}
+
+void gcta::grm_part_range(unsigned long n, unsigned long &r_start, unsigned long &r_end, bool out_log)
+{
+    // rows of the GRM in part _grm_part of _grm_part_num, the parts having about the same number of elements
+    r_start=0;
+    r_end=n;
+    if(_grm_part_num<1) return;
+    r_start=(unsigned long)(n*sqrt((double)(_grm_part-1)/_grm_part_num)+0.5);
+    r_end=(unsigned long)(n*sqrt((double)_grm_part/_grm_part_num)+0.5);
+    if(r_start>=r_end){
+        stringstream err_msg;
+        err_msg<<"Error: part "<<_grm_part<<" of the GRM is empty. Please specify fewer than "<<_grm_part_num<<" parts.";
+        throw(err_msg.str());
+    }
+    if(out_log) cout<<"Part "<<_grm_part<<" of "<<_grm_part_num<<": rows "<<r_start+1<<" to "<<r_end<<" of the GRM of "<<n<<" individuals."<<endl;
+}
+
+void gcta::count_miss_pair(const uint64_t *miss_bits, unsigned long word_num, const vector<int> &miss_indi, unsigned long r_start, unsigned long r_end, vector<float> &A_N)
+{
+    // A_N holds rows r_start to r_end-1 of the lower triangle;
+    // individuals are taken in tiles whose bitsets fit in the cache together
+    int t_size=16384/word_num, l=0, t=0, l_start=0, l_end=0;
+    if(t_size<1) t_size=1;
+    unsigned long t_start=r_start*(r_start+1)/2;
+    l_start=lower_bound(miss_indi.begin(), miss_indi.end(), (int)r_start)-miss_indi.begin();
+    l_end=lower_bound(miss_indi.begin(), miss_indi.end(), (int)r_end)-miss_indi.begin();
+    vector<int> ti, tj;
+    for(l=l_start; l<l_end; l+=t_size){
+        for(t=0; t<l+t_size && t<l_end; t+=t_size){
+            ti.push_back(l);
+            tj.push_back(t);
+        }
+    }
+
+    #pragma omp parallel for schedule(dynamic)
+    for(l=0; l<ti.size(); l++){
+        int i=0, j=0, i_end=ti[l]+t_size, j_end=tj[l]+t_size;
+        if(i_end>l_end) i_end=l_end;
+        for(i=ti[l]; i<i_end; i++){
+            const uint64_t *p=miss_bits+miss_indi[i]*word_num;
+            float *a=&A_N[(unsigned long)miss_indi[i]*(miss_indi[i]+1)/2-t_start];
+            for(j=tj[l]; j<j_end && j<=i; j++) a[miss_indi[j]]+=GenoDecode::and_count(p, miss_bits+miss_indi[j]*word_num, word_num);
+        }
+    }
+}
+
+void gcta::syrk_packed(const float *X, const vector<unsigned long> &c_pos, unsigned long r_start, unsigned long r_end, float *A, bool add)
+{
+    // rows r_start to r_end-1 of XX' by strips of rows, each strip computed with a GEMM against the rows above it
+    // and copied into the packed lower triangle; only the diagonal tiles are computed twice. X holds the chunks
+    // of columns c_pos[t] to c_pos[t+1]-1 one after the other, each r_end x (c_pos[t+1]-c_pos[t]), and the
+    // products of the chunks are added to a strip in turn
+    unsigned long i=0, j=0, t=0, w=0, i_start=0, i_end=0, t_size=256, t_start=r_start*(r_start+1)/2;
+    float *buf=new float[t_size*r_end];
+    for(i_start=r_start; i_start<r_end; i_start=i_end){
+        i_end=i_start+t_size;
+        if(i_end>r_end) i_end=r_end;
+        for(t=0; t+1<c_pos.size(); t++){
+            const float *Xt=X+r_end*c_pos[t];
+            w=c_pos[t+1]-c_pos[t];
+            cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, i_end-i_start, i_end, w, 1.0, Xt+i_start*w, w, Xt, w, 0.0, buf, i_end);
+            #pragma omp parallel for private(j)
+            for(i=i_start; i<i_end; i++){
+                float *a=A+i*(i+1)/2-t_start, *c=buf+(i-i_start)*i_end;
+                if(add || t>0){
+                    for(j=0; j<=i; j++) a[j]+=c[j];
+                }
+                else{
+                    for(j=0; j<=i; j++) a[j]=c[j];
+                }
+            }
+        }
+    }
+    delete[] buf;
+}
+
+void gcta::grm_mult(const MatrixXd &Q, MatrixXd &Y)
+{
+    // Y=AQ for the GRM in _grm by strips of rows: each strip is unpacked with its diagonal block made symmetric,
+    // multiplied with the rows of Q up to the end of the strip and, transposed, with the rows of Q in the strip
+    unsigned long i=0, j=0, n=_grm.n(), b=Q.cols(), s_size=256, i_start=0, i_end=0, ns=0;
+    const float *A=_grm.data();
+    Y.setZero(n, b);
+    double *buf=new double[s_size*n];
+    for(i_start=0; i_start<n; i_start=i_end){
+        i_end=min(i_start+s_size, n);
+        ns=i_end-i_start;
+        #pragma omp parallel for private(j)
+        for(i=i_start; i<i_end; i++){
+            double *t=buf+(i-i_start)*i_end;
+            const float *a=A+i*(i+1)/2;
+            for(j=0; j<=i; j++) t[j]=a[j];
+            for(j=i+1; j<i_end; j++) t[j]=A[j*(j+1)/2+i];
+        }
+        cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, ns, b, i_end, 1.0, buf, i_end, Q.data(), n, 1.0, Y.data()+i_start, n);
+        if(i_start>0) cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, i_start, b, ns, 1.0, buf, i_end, Q.data()+i_start, n, 1.0, Y.data(), n);
+    }
+    delete[] buf;
+}
+
+void gcta::geno_mult(const MatrixXd &Q, MatrixXd &Y)
+{
+    // Y=WW'Q/m for the standardised genotypes W of m SNPs, in one pass over the genotypes in blocks of SNPs
+    unsigned long i=0, j=0, n=_keep.size(), m=_include.size(), c=Q.cols(), blk=(_geno_block>0?_geno_block:1024), j_start=0, j_end=0, b=0;
+    float *X=new float[n*blk], *Z=new float[blk*c], *T=new float[n*c];
+    vector<float> Qf(n*c);
+    for(j=0; j<c; j++){
+        for(i=0; i<n; i++) Qf[j*n+i]=Q(i,j);
+    }
+    Y.setZero(n, c);
+    for(j_start=0; j_start<m; j_start=j_end){
+        j_end=min(j_start+blk, m);
+        b=j_end-j_start;
+        if(_geno_block>0) load_geno_block(j_start, j_end);
+        std_geno_block(j_start, j_end, X);
+        cblas_sgemm(CblasColMajor, CblasTrans, CblasNoTrans, b, c, n, 1.0, X, n, &Qf[0], n, 0.0, Z, b);
+        cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, n, c, b, 1.0, X, n, Z, b, 0.0, T, n);
+        #pragma omp parallel for private(i)
+        for(j=0; j<c; j++){
+            for(i=0; i<n; i++) Y(i,j)+=T[j*n+i];
+        }
+    }
+    Y/=(double)m;
+    delete[] X;
+    delete[] Z;
+    delete[] T;
+    if(_geno_block>0) _geno.clear();
+}
+
+void gcta::pca_geno(int out_pc_num, double tol, bool loading_flag)
+{
+    // PCA of the GRM WW'/m without forming it, where missing genotypes are set to the mean
+    check_autosome();
+    if(_mu.empty()) calcu_mu();
+    unsigned long i=0, j=0, l=0, n=_keep.size(), m=_include.size(), blk=(_geno_block>0?_geno_block:1024), j_start=0, j_end=0, b=0;
+    if(out_pc_num>n) out_pc_num=n;
+    cout<<"\nPerforming principal component analysis of "<<n<<" individuals and "<<m<<" SNPs for the first "<<out_pc_num<<" eigenvectors (tolerance "<<tol<<") ..."<<endl;
+    VectorXd eval;
+    MatrixXd evec;
+    eigen_approx(n, out_pc_num, tol, &gcta::geno_mult, eval, evec);
+    output_pca(eval, evec, out_pc_num, false);
+    if(!loading_flag) return;
+
+    // SNP loadings W'U/l for the k eigenvectors U and eigenvalues l, so that the principal components of an individual
+    // are the sum of its standardised genotypes times the loadings divided by m
+    string pcl_file=_out+".pcl";
+    ofstream o_pcl(pcl_file.c_str());
+    if(!o_pcl) throw("Error: can not open the file ["+pcl_file+"] to write.");
+    float *X=new float[n*blk], *Z=new float[blk*out_pc_num];
+    vector<float> Uf(n*out_pc_num);
+    for(l=0; l<out_pc_num; l++){
+        for(i=0; i<n; i++) Uf[l*n+i]=evec(i,l)/eval(l);
+    }
+    o_pcl<<"SNP\tA1\tA2\tfreq";
+    for(l=0; l<out_pc_num; l++) o_pcl<<"\tPC"<<l+1;
+    o_pcl<<endl;
+    for(j_start=0; j_start<m; j_start=j_end){
+        j_end=min(j_start+blk, m);
+        b=j_end-j_start;
+        if(_geno_block>0) load_geno_block(j_start, j_end);
+        std_geno_block(j_start, j_end, X);
+        cblas_sgemm(CblasColMajor, CblasTrans, CblasNoTrans, b, out_pc_num, n, 1.0, X, n, &Uf[0], n, 0.0, Z, b);
+        for(j=j_start; j<j_end; j++){
+            o_pcl<<_snp_name[_include[j]]<<"\t"<<_ref_A[_include[j]]<<"\t"<<_other_A[_include[j]]<<"\t"<<setprecision(15)<<_mu[_include[j]]*0.5<<setprecision(6);
+            for(l=0; l<out_pc_num; l++) o_pcl<<"\t"<<Z[l*b+j-j_start];
+            o_pcl<<endl;
+        }
+    }
+    delete[] X;
+    delete[] Z;
+    if(_geno_block>0) _geno.clear();
+    o_pcl.close();
+    cout<<"SNP loadings of the first "<<out_pc_num<<" principal components have been saved in ["+pcl_file+"]."<<endl;
+}
+
+void gcta::project_pca()
 {
-    unsigned long i=0, j=0, n=_keep.size();
- 	string grm_file;
+    // principal components of the individuals from the SNP loadings of a reference sample (read_pc_loading),
+    // in one pass over the genotypes; missing genotypes are skipped and the sum is scaled up accordingly
+    unsigned long i=0, j=0, l=0, n=_keep.size(), m=_include.size(), k=_pc_load.cols(), blk=(_geno_block>0?_geno_block:1024), j_start=0, j_end=0, b=0;
+    cout<<"\nProjecting "<<n<<" individuals onto "<<k<<" principal components using "<<m<<" SNPs ..."<<endl;
+    float *X=new float[n*blk], *L=new float[blk*k];
+    vector<double> pc(n*k);
+    vector<float> T(n*k);
+    vector<int> miss_num(n);
+    for(j_start=0; j_start<m; j_start=j_end){
+        j_end=min(j_start+blk, m);
+        b=j_end-j_start;
+        if(_geno_block>0) load_geno_block(j_start, j_end);
+        std_geno_block(j_start, j_end, X);
+        for(j=j_start; j<j_end; j++){
+            int r=_pc_load_indx[_include[j]];
+            for(l=0; l<k; l++) L[l*b+j-j_start]=_pc_load(r,l);
+        }
+        cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, n, k, b, 1.0, X, n, L, b, 0.0, &T[0], n);
+        #pragma omp parallel for private(j, l)
+        for(i=0; i<n; i++){
+            for(l=0; l<k; l++) pc[l*n+i]+=T[l*n+i];
+            for(j=j_start; j<j_end; j++){
+                if(GenoStore::miss(_geno.get(geno_snp(j), geno_keep()[i]))) miss_num[i]++;
+            }
+        }
+    }
+    delete[] X;
+    delete[] L;
+    if(_geno_block>0) _geno.clear();
+
+    string evec_file=_out+".proj.eigenvec";
+    ofstream o_evec(evec_file.c_str());
+    if(!o_evec) throw("Error: can not open the file ["+evec_file+"] to write.");
+    for(i=0; i<n; i++){
+        o_evec<<_fid[_keep[i]]<<" "<<_pid[_keep[i]];
+        double m_eff=(double)(m-miss_num[i]);
+        for(l=0; l<k; l++) o_evec<<" "<<(m_eff>0.0?pc[l*n+i]/m_eff:0.0);
+        o_evec<<endl;
+    }
+    o_evec.close();
+    cout<<"The projected "<<k<<" principal components of "<<n<<" individuals have been saved in ["+evec_file+"]."<<endl;
+}
+
+// the GRM is saved as [_out].[grp_name] if grp_name is given, followed by .part_[_grm_part_num]_[_grm_part] for a part of the GRM
+void gcta::output_grm_mkl(float* A, vector<float> &A_N, bool output_grm_bin, string grp_name)
+{
+    unsigned long i=0, j=0, k=0, n=_keep.size(), r_start=0, r_end=0;
+ 	string grm_file, out=_out;
+    if(!grp_name.empty()) out+="."+grp_name;
+    if(_grm_part_num>0){
+        stringstream ss;
+        ss<<out<<".part_"<<_grm_part_num<<"_"<<_grm_part;
+        out=ss.str();
+    }
+    grm_part_range(n, r_start, r_end, false);
     
-    if(output_grm_bin){
+    if(_grm_cbin_type>-1){
+        grm_file=out+".grm.cbin";
+        GrmCbin::write(grm_file, A, &A_N[0], n, _grm_cbin_type);
+        cout<<"GRM of "<<n<<" individuals and the number of SNPs for each pair have been saved in the file ["+grm_file+"] (in chunked binary format)."<<endl;
+    }
+    else if(output_grm_bin){
         // Save matrix A in binary file
-        grm_file=_out+".grm.bin";
+        grm_file=out+".grm.bin";
         fstream A_Bin(grm_file.c_str(), ios::out|ios::binary);
         if(!A_Bin) throw("Error: can not open the file ["+grm_file+"] to write.");
-		int size=sizeof(float);
-        for(i=0; i<n; i++){
-            for(j=0; j<=i; j++) A_Bin.write((char*)&(A[i*n+j]), size);
-        }
+        A_Bin.write((char*)A, sizeof(float)*A_N.size());
         A_Bin.close();
 		cout<<"GRM of "<<n<<" individuals has been saved in the file ["+grm_file+"] (in binary format)."<<endl;
         
-        string grm_N_file=_out+".grm.N.bin";
+        string grm_N_file=out+".grm.N.bin";
         fstream N_Bin(grm_N_file.c_str(), ios::out|ios::binary);
         if(!N_Bin) throw("Error: can not open the file ["+grm_N_file+"] to write.");
-        size=sizeof(float);
-        for(i=0; i<n; i++){
-            for(j=0; j<=i; j++) N_Bin.write((char*)&(A_N[i][j]), size);
-        }
+        N_Bin.write((char*)&A_N[0], sizeof(float)*A_N.size());
         N_Bin.close();
         cout<<"Number of SNPs to calcuate the genetic relationship between each pair of individuals has been saved in the file ["+grm_N_file+"] (in binary format)."<<endl;
     }
     else{
         // Save A matrix in txt format
-        grm_file=_out+".grm.gz";
+        grm_file=out+".grm.gz";
         gzofstream zoutf;
         zoutf.open( grm_file.c_str() );
         if(!zoutf.is_open()) throw("Error: can not open the file ["+grm_file+"] to write.");
         cout<<"Saving the genetic relationship matrix to the file ["+grm_file+"] (in compressed text format)."<<endl;
         zoutf.setf(ios::scientific);
         zoutf.precision(6);
-        for(i=0; i<n; i++){
-            for(j=0; j<=i; j++) zoutf<<i+1<<'\t'<<j+1<<'\t'<<A_N[i][j]<<'\t'<<A[i*n+j]<<endl;
+        for(i=r_start; i<r_end; i++){
+            for(j=0; j<=i; j++, k++) zoutf<<i+1<<'\t'<<j+1<<'\t'<<A_N[k]<<'\t'<<A[k]<<'\n';
         }
         zoutf.close();
         cout<<"The genetic relationship matrix has been saved in the file ["+grm_file+"] (in compressed text format)."<<endl;
     }
 	
-	string famfile=_out+".grm.id";
+	string famfile=out+".grm.id";
 	ofstream Fam(famfile.c_str());
 	if(!Fam) throw("Error: can not open the file ["+famfile+"] to write.");
-	for(i=0; i<n; i++) Fam<<_fid[_keep[i]]+"\t"+_pid[_keep[i]]<<endl;
+	for(i=r_start; i<r_end; i++) Fam<<_fid[_keep[i]]+"\t"+_pid[_keep[i]]<<endl;
 	Fam.close();
 	cout<<"IDs for the GRM file ["+grm_file+"] have been saved in the file ["+famfile+"]."<<endl;
 }
@@ -277,104 +1144,134 @@ void gcta::output_grm_mkl(float* A, vector< vector<float> > &A_N, bool output_gr
 ///////////
 // reml
 
-bool gcta::comput_inverse_logdet_LDLT_mkl(eigenMatrix &Vi, double &logdet)
+bool gcta::eigen_sym_mkl(eigenMatrix &A, eigenVector &eval)
 {
-	unsigned long i=0, j=0, n=Vi.cols();
-	double* Vi_mkl=new double[n*n];
-	//float* Vi_mkl=new float[n*n];
-	
+    // eigenvalues (ascending) and eigenvectors of a symmetric matrix by divide and conquer; A is replaced by the eigenvectors
+	unsigned long i=0, j=0, n=A.cols();
+	double* A_mkl=new double[n*n];
+
 #pragma omp parallel for private(j)
-	for(i=0; i<n; i++){
-		for(j=0; j<n; j++){
-			Vi_mkl[i*n+j]=Vi(i,j);
-		}
+	for(j=0; j<n; j++){
+		for(i=j; i<n; i++) A_mkl[j*n+i]=A(i,j);
     }
-	
-	// MKL's Cholesky decomposition
+
+	int info=0, int_n=(int)n, lwork=-1, liwork=-1, iwork_buf=0;
+	char jobz='V', uplo='L';
+    double work_buf=0.0;
+    double *w_mkl=new double[n];
+	dsyevd(&jobz, &uplo, &int_n, A_mkl, &int_n, w_mkl, &work_buf, &lwork, &iwork_buf, &liwork, &info);
+    lwork=(int)work_buf;
+    liwork=iwork_buf;
+    double *work=new double[lwork];
+    int *iwork=new int[liwork];
+	dsyevd(&jobz, &uplo, &int_n, A_mkl, &int_n, w_mkl, work, &lwork, iwork, &liwork, &info);
+    delete[] work;
+    delete[] iwork;
+	if(info<0) throw("Error: eigendecomposition failed. Invalid values found in the matrix.\n");
+	else if(info>0){
+        delete[] A_mkl;
+        delete[] w_mkl;
+        return false;
+    }
+
+    eval.resize(n);
+    for(i=0; i<n; i++) eval(i)=w_mkl[i];
+#pragma omp parallel for private(i)
+	for(j=0; j<n; j++){
+		for(i=0; i<n; i++) A(i,j)=A_mkl[j*n+i];
+    }
+	delete[] A_mkl;
+    delete[] w_mkl;
+	return true;
+}
+
+// LAPACK routines for V in single or double precision
+static void lapack_potrf(char *uplo, int *n, float *a, int *info) {spotrf(uplo, n, a, n, info);}
+static void lapack_potrf(char *uplo, int *n, double *a, int *info) {dpotrf(uplo, n, a, n, info);}
+static void lapack_potri(char *uplo, int *n, float *a, int *info) {spotri(uplo, n, a, n, info);}
+static void lapack_potri(char *uplo, int *n, double *a, int *info) {dpotri(uplo, n, a, n, info);}
+static void lapack_getrf(int *n, float *a, int *ipiv, int *info) {sgetrf(n, n, a, n, ipiv, info);}
+static void lapack_getrf(int *n, double *a, int *ipiv, int *info) {dgetrf(n, n, a, n, ipiv, info);}
+static void lapack_getri(int *n, float *a, int *ipiv, float *work, int *lwork, int *info) {sgetri(n, a, n, ipiv, work, lwork, info);}
+static void lapack_getri(int *n, double *a, int *ipiv, double *work, int *lwork, int *info) {dgetri(n, a, n, ipiv, work, lwork, info);}
+
+template<typename MatType>
+bool gcta::comput_inverse_logdet_LDLT_mkl(MatType &Vi, double &logdet)
+{
+    // factorised and inverted in place (column-major as LAPACK); only the lower triangle is overwritten
+    // so that Vi can be restored from the upper triangle if V is not positive definite
+	unsigned long i=0, j=0, n=Vi.cols();
 	int info=0, int_n=(int)n;
 	char uplo='L';
-	dpotrf( &uplo, &int_n, Vi_mkl, &int_n, &info );
-	//spotrf( &uplo, &n, Vi_mkl, &n, &info );
+    Matrix<typename MatType::Scalar, Dynamic, 1> diag=Vi.diagonal();
+	
+	// MKL's Cholesky decomposition
+	lapack_potrf(&uplo, &int_n, Vi.data(), &info);
 	if(info<0) throw("Error: Cholesky decomposition failed. Invalid values found in the matrix.\n");
-	else if (info>0) return(false); //Vi.diagonal()=Vi.diagonal().array()+Vi.diagonal().mean()*1e-3;
-	else{
-		logdet=0.0;
-		for(i=0; i<n; i++) {
-			double d_buf=Vi_mkl[i*n+i];
-			logdet+=log(d_buf*d_buf);
-		}
+	else if (info>0){
+        Vi.diagonal()=diag;
+#pragma omp parallel for private(i)
+        for(j=0; j<n; j++){
+            for(i=j+1; i<n; i++) Vi(i,j)=Vi(j,i);
+        }
+        return(false);
+    }
+	logdet=0.0;
+	for(i=0; i<n; i++) {
+		double d_buf=Vi(i,i);
+		logdet+=log(d_buf*d_buf);
+	}
 		
-		// Calcualte V inverse
-		dpotri(&uplo, &int_n, Vi_mkl, &int_n, &info);
-		//spotri( &uplo, &n, Vi_mkl, &n, &info );
-		if(info<0) throw("Error: invalid values found in the varaince-covaraince (V) matrix.\n");
-		else if (info>0) return(false); // Vi.diagonal()=Vi.diagonal().array()+Vi.diagonal().mean()*1e-3;
-		else{
-#pragma omp parallel for private(j)
-			for(j=0; j<n; j++){
-				for(i=0; i<=j; i++) Vi(i,j)=Vi(j,i)=Vi_mkl[i*n+j];
-			}
-		}
+	// Calcualte V inverse
+	lapack_potri(&uplo, &int_n, Vi.data(), &info);
+	if(info<0) throw("Error: invalid values found in the varaince-covaraince (V) matrix.\n");
+	else if (info>0) return(false);
+#pragma omp parallel for private(i)
+	for(j=0; j<n; j++){
+		for(i=j+1; i<n; i++) Vi(j,i)=Vi(i,j);
 	}
 	
-	// free memory
-	delete[] Vi_mkl;
-	
 	return true;
-	
 }
 
-bool gcta::comput_inverse_logdet_LU_mkl(eigenMatrix &Vi, double &logdet)
+template<typename MatType>
+bool gcta::comput_inverse_logdet_LU_mkl(MatType &Vi, double &logdet)
 {
+    // factorised and inverted in place; the workspace is sized by a workspace query and kept for the next iterations
 	unsigned long i=0, j=0, n=Vi.cols();
-	double* Vi_mkl=new double[n*n];
-	
-    #pragma omp parallel for private(j)
-	for(i=0; i<n; i++){
-		for(j=0; j<n; j++){
-			Vi_mkl[i*n+j]=Vi(i,j);
-		}
-    }
-    
-    int N=(int)n;
-    int *IPIV = new int[n+1];
-    int LWORK = N*N;
-    double *WORK = new double[n*n];
-    int INFO;
-    dgetrf(&N,&N,Vi_mkl,&N,IPIV,&INFO);
+    int N=(int)n, LWORK=-1, INFO=0;
+    Matrix<typename MatType::Scalar, Dynamic, 1> &work=V_inv_work(typename MatType::Scalar());
+    if(work.size()<1) work.resize(1);
+    _V_inv_ipiv.resize(n);
+    lapack_getrf(&N, Vi.data(), &_V_inv_ipiv[0], &INFO);
 	if(INFO<0) throw("Error: LU decomposition failed. Invalid values found in the matrix.\n");
-	else if (INFO>0){
-        delete[] Vi_mkl;
-        return(false); //Vi.diagonal()=Vi.diagonal().array()+Vi.diagonal().mean()*1e-3;
-    }
-	else{
-		logdet=0.0;
-		for(i=0; i<n; i++) {
-			double d_buf=Vi_mkl[i*n+i];
-			logdet+=log(fabs(d_buf));
-		}
+	else if (INFO>0) return(false);
+	logdet=0.0;
+	for(i=0; i<n; i++) {
+		double d_buf=Vi(i,i);
+		logdet+=log(fabs(d_buf));
+	}
 		
-		// Calcualte V inverse
-        dgetri(&N,Vi_mkl,&N,IPIV,WORK,&LWORK,&INFO);
-		if(INFO<0) throw("Error: invalid values found in the varaince-covaraince (V) matrix.\n");
-		else if (INFO>0) return(false); // Vi.diagonal()=Vi.diagonal().array()+Vi.diagonal().mean()*1e-3;
-		else{
-            #pragma omp parallel for private(j)
-			for(j=0; j<n; j++){
-				for(i=0; i<=j; i++) Vi(i,j)=Vi(j,i)=Vi_mkl[i*n+j];
-			}
-		}
+	// Calcualte V inverse
+    lapack_getri(&N, Vi.data(), &_V_inv_ipiv[0], work.data(), &LWORK, &INFO);
+    LWORK=(int)work[0];
+    if(work.size()<LWORK) work.resize(LWORK);
+    lapack_getri(&N, Vi.data(), &_V_inv_ipiv[0], work.data(), &LWORK, &INFO);
+	if(INFO<0) throw("Error: invalid values found in the varaince-covaraince (V) matrix.\n");
+	else if (INFO>0) return(false);
+    #pragma omp parallel for private(i)
+	for(j=0; j<n; j++){
+		for(i=j+1; i<n; i++) Vi(j,i)=Vi(i,j);
 	}
 	
-	// free memory
-    delete[] Vi_mkl;
-    delete[] IPIV;
-    delete[] WORK;
-	
 	return true;
-	
 }
 
+template bool gcta::comput_inverse_logdet_LDLT_mkl(MatrixXf &Vi, double &logdet);
+template bool gcta::comput_inverse_logdet_LDLT_mkl(MatrixXd &Vi, double &logdet);
+template bool gcta::comput_inverse_logdet_LU_mkl(MatrixXf &Vi, double &logdet);
+template bool gcta::comput_inverse_logdet_LU_mkl(MatrixXd &Vi, double &logdet);
+
 bool gcta::comput_inverse_logdet_LU_mkl_array(int n, float *Vi, double &logdet)
 {
 	unsigned long i=0, j=0;
@@ -69,18 +69,15 @@ void gcta::mlma(string grm_file, string phen_file, string qcovar_file, string co
     for(i=0; i<2; i++) _r_indx.push_back(i);
     _A.resize(_r_indx.size());
     StrFunc::match(uni_id, grm_id, kp);
-    (_A[0])=eigenMatrix::Zero(_n, _n);
+    (_A[0]).resize(_n, _n);
     if(grm_flag){
-        #pragma omp parallel for private(j)
-        for(i=0; i<_n; i++){
-            for(j=0; j<=i; j++) (_A[0])(j,i)=(_A[0])(i,j)=_grm(kp[i],kp[j]);
-        }
-        _grm.resize(0,0);
+        _grm.fill(kp, (_A[0]).data());
+        _grm.clear();
     }
     else{
         #pragma omp parallel for private(j)
         for(i=0; i<_n; i++){
-            for(j=0; j<=i; j++) (_A[0])(j,i)=(_A[0])(i,j)=_grm_mkl[kp[i]*_n+kp[j]];
+            for(j=0; j<=i; j++) (_A[0])(j,i)=(_A[0])(i,j)=_grm_mkl[tri_indx(kp[i], kp[j])];
         }
         delete[] _grm_mkl;
     }
@@ -95,11 +92,13 @@ void gcta::mlma(string grm_file, string phen_file, string qcovar_file, string co
     _var_name.push_back("V(G)");
     _hsq_name.push_back("V(G)/Vp");
     _var_name.push_back("V(e)");
+    if(grm_flag) init_reml_spectral(grm_file, uni_id, false);
     
     // run REML algorithm
     cout<<"\nPerforming MLM association analyses (including the candidate SNP) ..."<<endl;
     unsigned long k=0, n=_keep.size(), m=_include.size();
 	reml(false, true, reml_priors, reml_priors_var, -2.0, -2.0, no_constrain, true, true);
+    if(_reml_spectral) calcu_Vi_spectral(_varcmp);
     _P.resize(0,0);
     _A.clear();
     float *y=new float[n];
@@ -333,7 +332,7 @@ void gcta::mlma_loco(string phen_file, string qcovar_file, string covar_file, in
             #pragma omp parallel for private(j)
             for(i=0; i<_n; i++){
                 for(j=0; j<=i; j++){
-                    (_A[0])(i,j)+=(grm_chrs[c2])[kp[i]*_n+kp[j]]*m_chrs_f[c2];
+                    (_A[0])(i,j)+=(grm_chrs[c2])[tri_indx(kp[i], kp[j])]*m_chrs_f[c2];
                 }
             }
             d_buf+=m_chrs_f[c2];
@@ -61,10 +61,11 @@ void option(int option_num, char* option_str[])
 
 	// GRM
 	bool ibc=false, ibc_all=false, grm_flag=false, grm_bin_flag=true, m_grm_flag=false, m_grm_bin_flag=true, make_grm_flag=false, make_grm_inbred_flag=false, make_grm_xchar_flag=false, grm_out_bin_flag=true, make_grm_f3_flag=false;
-	bool pca_flag=false;
-	double grm_adj_fac=-2.0, grm_cutoff=-2.0;
-	int dosage_compen=-2, out_pc_num=20, make_grm_mtd=0;
-	string grm_file="", paa_file="";
+	bool pca_flag=false, make_grm_chr_flag=false, grm_cbin_flag=false, grm_cbin_out_flag=false, make_grm_sp_flag=false, grm_sp_flag=false, pca_approx_flag=false, pca_loading_flag=false, make_grm_eigen_flag=false;
+	double grm_adj_fac=-2.0, grm_cutoff=-2.0, make_grm_sp_cutoff=0.05, pca_tol=1e-5;
+	int dosage_compen=-2, out_pc_num=20, grm_cbin_type=-1, make_grm_mtd=0, make_grm_block=0, pca_block=0, grm_part_num=0, grm_part=0, merge_grm_part_num=0;
+	string grm_file="", paa_file="", merge_grm_part_file="", make_grm_snp_grp_file="", pc_load_file="";
+	vector<double> make_grm_maf_bin;
 
 	// LD
 	string LD_file="", i_ld_file="";
@@ -88,9 +89,9 @@ void option(int option_num, char* option_str[])
 	string hapmap_genet_dst_file="";
 
 	// REML analysis
-	int mphen=1, mphen2=2, reml_mtd=0, MaxIter=100;
+	int mphen=1, mphen2=2, reml_mtd=0, MaxIter=100, reml_precision=0;
 	double prevalence=-2.0, prevalence2=-2.0;
-	bool reml_flag=false, pred_rand_eff=false, est_fix_eff=false, blup_snp_flag=false, no_constrain=false, reml_lrt_flag=false, no_lrt=false, bivar_reml_flag=false, ignore_Ce=false, within_family=false, reml_bending=false, HE_reg_flag=false, reml_diag_one=false, bivar_no_constrain=false;
+	bool reml_flag=false, pred_rand_eff=false, est_fix_eff=false, blup_snp_flag=false, no_constrain=false, reml_lrt_flag=false, no_lrt=false, bivar_reml_flag=false, ignore_Ce=false, within_family=false, reml_bending=false, HE_reg_flag=false, reml_diag_one=false, bivar_no_constrain=false, reml_spectral=false;
 	string phen_file="", qcovar_file="", covar_file="", qgxe_file="", gxe_file="", blup_indi_file="";
 	vector<double> reml_priors, reml_priors_var, fixed_rg_val;
 	vector<int> reml_drop;
@@ -289,6 +290,18 @@ void option(int option_num, char* option_str[])
 			grm_file=argv[++i];
 			cout<<"--mgrm-gz "<<grm_file<<endl;
 		}
+		else if(strcmp(argv[i],"--mgrm-sparse")==0){
+			m_grm_flag=true;
+			grm_sp_flag=true;
+			grm_file=argv[++i];
+			cout<<"--mgrm-sparse "<<grm_file<<endl;
+		}
+		else if(strcmp(argv[i],"--grm-sparse")==0){
+			grm_flag=true;
+			grm_sp_flag=true;
+			grm_file=argv[++i];
+			cout<<"--grm-sparse "<<grm_file<<endl;
+		}
 		else if(strcmp(argv[i],"--grm")==0 || strcmp(argv[i],"--grm-bin")==0){
 			grm_flag=true;
 			grm_file=argv[++i];
@@ -301,6 +314,18 @@ void option(int option_num, char* option_str[])
 			grm_file=argv[++i];
 			cout<<"--grm-gz "<<grm_file<<endl;
 		}
+		else if(strcmp(argv[i],"--mgrm-cbin")==0){
+			m_grm_flag=true;
+			grm_cbin_flag=true;
+			grm_file=argv[++i];
+			cout<<"--mgrm-cbin "<<grm_file<<endl;
+		}
+		else if(strcmp(argv[i],"--grm-cbin")==0){
+			grm_flag=true;
+			grm_cbin_flag=true;
+			grm_file=argv[++i];
+			cout<<"--grm-cbin "<<grm_file<<endl;
+		}
 		else if(strcmp(argv[i],"--make-grm")==0 || strcmp(argv[i],"--make-grm-bin")==0){
 			make_grm_flag=true;
             thread_flag=true;
@@ -312,6 +337,27 @@ void option(int option_num, char* option_str[])
             thread_flag=true;
 			cout<<"--make-grm-gz"<<endl;
 		}
+        else if(strcmp(argv[i],"--make-grm-cbin")==0){
+		    make_grm_flag=true;
+			grm_cbin_out_flag=true;
+            thread_flag=true;
+			cout<<"--make-grm-cbin"<<endl;
+		}
+        else if(strcmp(argv[i],"--make-grm-sparse")==0){
+		    make_grm_flag=true;
+			make_grm_sp_flag=true;
+			make_grm_sp_cutoff=atof(argv[++i]);
+            thread_flag=true;
+			cout<<"--make-grm-sparse "<<make_grm_sp_cutoff<<endl;
+		}
+		else if(strcmp(argv[i],"--grm-cbin-type")==0){
+			string type_buf=argv[++i];
+			cout<<"--grm-cbin-type "<<type_buf<<endl;
+			if(type_buf=="float") grm_cbin_type=GrmCbin::F32;
+			else if(type_buf=="float16") grm_cbin_type=GrmCbin::F16;
+			else if(type_buf=="bfloat16") grm_cbin_type=GrmCbin::BF16;
+			else throw("\nError: --grm-cbin-type should be float, float16 or bfloat16.\n");
+		}
 		else if(strcmp(argv[i],"--make-grm-alg")==0){
             make_grm_flag=true;
 			make_grm_mtd=atoi(argv[++i]);
@@ -319,6 +365,58 @@ void option(int option_num, char* option_str[])
 			cout<<"--make-grm-alg "<<make_grm_mtd<<endl;
 			if(make_grm_mtd<0 || make_grm_mtd>1) throw("\nError: --make-grm-alg should be 0 or 1.\n");
 		}
+		else if(strcmp(argv[i],"--make-grm-block")==0){
+            make_grm_flag=true;
+			make_grm_block=atoi(argv[++i]);
+            thread_flag=true;
+			cout<<"--make-grm-block "<<make_grm_block<<endl;
+			if(make_grm_block<1) throw("\nError: --make-grm-block should be a positive number of SNPs.\n");
+		}
+		else if(strcmp(argv[i],"--make-grm-part")==0){
+            make_grm_flag=true;
+			grm_part_num=atoi(argv[++i]);
+			grm_part=atoi(argv[++i]);
+            thread_flag=true;
+			cout<<"--make-grm-part "<<grm_part_num<<" "<<grm_part<<endl;
+			if(grm_part_num<1 || grm_part<1 || grm_part>grm_part_num) throw("\nError: --make-grm-part should be followed by the number of parts and the part to calculate (from 1 to the number of parts).\n");
+		}
+		else if(strcmp(argv[i],"--make-grm-chr")==0){
+            make_grm_flag=true;
+			make_grm_chr_flag=true;
+            thread_flag=true;
+			cout<<"--make-grm-chr"<<endl;
+		}
+		else if(strcmp(argv[i],"--make-grm-maf-bins")==0){
+            make_grm_flag=true;
+		    while(1){
+		        i++;
+		        if(strcmp(argv[i],"gcta")==0 || strncmp(argv[i], "--", 2)==0) break;
+		        make_grm_maf_bin.push_back(atof(argv[i]));
+		    }
+		    i--;
+            thread_flag=true;
+			cout<<"--make-grm-maf-bins ";
+			bool err_flag=false;
+			for(j=0; j<make_grm_maf_bin.size(); j++){
+			    cout<<make_grm_maf_bin[j]<<" ";
+			    if(make_grm_maf_bin[j]<=0.0 || make_grm_maf_bin[j]>=0.5 || (j>0 && make_grm_maf_bin[j]<=make_grm_maf_bin[j-1])) err_flag=true;
+            }
+			cout<<endl;
+			if(err_flag || make_grm_maf_bin.empty()) throw("\nError: --make-grm-maf-bins. The MAF boundaries should be in ascending order within the range from 0 to 0.5.\n");
+		}
+		else if(strcmp(argv[i],"--make-grm-snp-group")==0){
+            make_grm_flag=true;
+			make_grm_snp_grp_file=argv[++i];
+            thread_flag=true;
+			cout<<"--make-grm-snp-group "<<make_grm_snp_grp_file<<endl;
+			CommFunc::FileExist(make_grm_snp_grp_file);
+		}
+		else if(strcmp(argv[i],"--merge-grm-part")==0){
+			merge_grm_part_file=argv[++i];
+			merge_grm_part_num=atoi(argv[++i]);
+			cout<<"--merge-grm-part "<<merge_grm_part_file<<" "<<merge_grm_part_num<<endl;
+			if(merge_grm_part_num<1) throw("\nError: --merge-grm-part should be followed by the root filename of the GRM parts and the number of parts.\n");
+		}
         else if(strcmp(argv[i],"--make-grm-f3")==0){
 		    make_grm_f3_flag=true;
 			grm_out_bin_flag=true;
@@ -366,6 +464,10 @@ void option(int option_num, char* option_str[])
 			if(grm_cutoff>=-1 && grm_cutoff<=2) cout<<"--grm-cutoff "<<grm_cutoff<<endl;
             else grm_cutoff=-2;
 		}
+		else if(strcmp(argv[i],"--make-grm-eigen")==0){
+		    make_grm_eigen_flag=true;
+			cout<<"--make-grm-eigen"<<endl;
+		}
 		else if(strcmp(argv[i],"--pca")==0){
 		    pca_flag=true;
             thread_flag=true;
@@ -375,6 +477,31 @@ void option(int option_num, char* option_str[])
 			cout<<"--pca "<<out_pc_num<<endl;
 			if(out_pc_num<1) throw("\nError: the value to be specified after --pca should be positive.\n");
 		}
+		else if(strcmp(argv[i],"--pca-approx")==0){
+		    pca_approx_flag=true;
+			cout<<"--pca-approx"<<endl;
+		}
+		else if(strcmp(argv[i],"--pca-loading")==0){
+		    pca_loading_flag=true;
+			cout<<"--pca-loading"<<endl;
+		}
+		else if(strcmp(argv[i],"--pca-block")==0){
+			pca_block=atoi(argv[++i]);
+			cout<<"--pca-block "<<pca_block<<endl;
+			if(pca_block<1) throw("\nError: --pca-block should be a positive number of SNPs.\n");
+		}
+		else if(strcmp(argv[i],"--project-loading")==0){
+			pc_load_file=argv[++i];
+            thread_flag=true;
+			cout<<"--project-loading "<<pc_load_file<<endl;
+			CommFunc::FileExist(pc_load_file);
+		}
+		else if(strcmp(argv[i],"--pca-tol")==0){
+		    pca_approx_flag=true;
+			pca_tol=atof(argv[++i]);
+			cout<<"--pca-tol "<<pca_tol<<endl;
+			if(pca_tol<=0.0 || pca_tol>=1.0) throw("\nError: --pca-tol should be within the range from 0 to 1.\n");
+		}
 		// estimation of LD structure
 		else if(strcmp(argv[i],"--ld")==0){
 			LD=true;
@@ -589,6 +716,18 @@ void option(int option_num, char* option_str[])
 			reml_diag_one=true;
 			cout<<"--reml-diag-one "<<endl;
 		}
+		else if(strcmp(argv[i],"--reml-spectral")==0){
+			reml_spectral=true;
+			cout<<"--reml-spectral "<<endl;
+		}
+		else if(strcmp(argv[i],"--reml-precision")==0){
+			string precision=argv[++i];
+			cout<<"--reml-precision "<<precision<<endl;
+			if(precision=="double") reml_precision=0;
+			else if(precision=="float") reml_precision=1;
+			else if(precision=="mixed") reml_precision=2;
+			else throw("\nError: --reml-precision should be float, mixed or double.\n");
+		}
 		else if(strcmp(argv[i],"--pheno")==0){
 			phen_file=argv[++i];
 			cout<<"--pheno "<<phen_file<<endl;
@@ -809,6 +948,17 @@ void option(int option_num, char* option_str[])
 	    if(grm_adj_fac>-1.0){ grm_adj_fac=-2.0; cout<<"Warning: --grm-adj option suppressed by the --pca option."<<endl; }
 	    else if(dosage_compen>-1){ grm_adj_fac=-2; cout<<"Warning: --dosage-compen option suppressed by the --pca option."<<endl; }
 	}
+    if(make_grm_eigen_flag && ((!grm_flag && !m_grm_flag) || reml_flag || bivar_reml_flag || pca_flag || make_grm_flag)) throw("Error: the option --make-grm-eigen should be used with --grm (or --mgrm) only.");
+    if(pca_loading_flag && (!pca_flag || !bfile_flag || grm_flag || m_grm_flag)) throw("Error: the option --pca-loading only works with --pca on the genotype data in PLINK binary format (--bfile).");
+    if(!pc_load_file.empty()){
+        if(!bfile_flag || bfile2_flag) throw("Error: the option --project-loading only works with the genotype data in PLINK binary format (--bfile).");
+        if(pca_flag || make_grm_flag) throw("Error: the option --project-loading can't be used in combination with --pca or --make-grm.");
+        if(!update_freq_file.empty() || !update_refA_file.empty()) throw("Error: the option --project-loading can't be used in combination with --update-freq or --update-ref-allele because the allele frequencies are read from the SNP loadings.");
+    }
+    if(pca_block>0){
+        if(!bfile_flag || bfile2_flag || ((!pca_flag || grm_flag || m_grm_flag) && pc_load_file.empty())) throw("Error: the option --pca-block only works with --pca or --project-loading on the genotype data in PLINK binary format (--bfile).");
+        if(make_grm_flag || out_freq_flag || ibc || !paa_file.empty()) throw("Error: the option --pca-block can't be used in combination with --make-grm, --freq, --ibc or --paa.");
+    }
     if(!gxe_file.empty() && !grm_flag && !m_grm_flag){
         cout<<"Warning: --gxe option is ignored because there is no --grm or --mgrm option specified."<<endl;
         gxe_file="";
@@ -817,6 +967,40 @@ void option(int option_num, char* option_str[])
         cout<<"Warning: --reml-pred-rand option is ignored because there is no --grm or --mgrm option specified."<<endl;
         pred_rand_eff=false;
     }
+    if(make_grm_block>0 && (ibc || !paa_file.empty())){
+        cout<<"Warning: --make-grm-block option suppressed by the --ibc or --paa option."<<endl;
+        make_grm_block=0;
+    }
+    if(make_grm_block>0 && (mlma_flag || mlma_loco_flag || dose_beagle_flag || dose_mach_flag)) throw("Error: the option --make-grm-block only works with the genotype data in PLINK binary format (--bfile) and can't be used in combination with --mlma or --mlma-loco.");
+    if((int)make_grm_chr_flag+(int)!make_grm_maf_bin.empty()+(int)!make_grm_snp_grp_file.empty()>1) throw("Error: only one of the options --make-grm-chr, --make-grm-maf-bins and --make-grm-snp-group can be specified.");
+    if(make_grm_chr_flag || !make_grm_maf_bin.empty() || !make_grm_snp_grp_file.empty()){
+        if(make_grm_xchar_flag) throw("Error: the option --make-grm-chr, --make-grm-maf-bins or --make-grm-snp-group can't be used in combination with --make-grm-xchr.");
+        if(dose_beagle_flag || dose_mach_flag) throw("Error: the option --make-grm-chr, --make-grm-maf-bins or --make-grm-snp-group only works with the genotype data in PLINK binary format.");
+        if(grm_part_num>0) throw("Error: the option --make-grm-chr, --make-grm-maf-bins or --make-grm-snp-group can't be used in combination with --make-grm-part.");
+    }
+    if(make_grm_sp_flag){
+        if(make_grm_chr_flag || !make_grm_maf_bin.empty() || !make_grm_snp_grp_file.empty() || grm_part_num>0 || grm_cbin_out_flag || !grm_out_bin_flag) throw("Error: the option --make-grm-sparse can't be used in combination with the options to partition or format the GRM.");
+        if(make_grm_block>0) throw("Error: the option --make-grm-sparse can't be used in combination with --make-grm-block.");
+        if(dose_beagle_flag || dose_mach_flag) throw("Error: the option --make-grm-sparse only works with the genotype data in PLINK binary format.");
+    }
+    if(grm_cbin_out_flag && !grm_out_bin_flag) throw("Error: the option --make-grm-cbin can't be used in combination with the GRM in compressed text format.");
+    if(grm_cbin_type>-1 && !grm_cbin_out_flag) throw("Error: the option --grm-cbin-type only works with --make-grm-cbin.");
+    if(grm_part_num>0 && grm_cbin_out_flag) throw("Error: the option --make-grm-part only works with the GRM in binary format (.grm.bin).");
+    if(grm_part_num>0 && !grm_out_bin_flag) throw("Error: the option --make-grm-part only works with the GRM in binary format.");
+    if(grm_sp_flag){
+        if(!reml_flag || bivar_reml_flag || mlma_flag || mlma_loco_flag || HE_reg_flag) throw("Error: the sparse GRM (--grm-sparse or --mgrm-sparse) can only be used in a univariate REML analysis (--reml).");
+        if(reml_mtd!=0) throw("Error: only the AI-REML algorithm (--reml-alg 0) is available with the sparse GRM.");
+        if(!qgxe_file.empty() || !gxe_file.empty() || grm_cutoff>-1.0 || grm_adj_fac>-1.0 || dosage_compen>-1 || reml_bending || reml_diag_one || within_family) throw("Error: the options --gxe, --gxqe, --grm-cutoff, --grm-adj, --dc, --reml-bending, --reml-diag-one and --reml-wfam can't be used with the sparse GRM.");
+    }
+    if(reml_spectral){
+        if(!reml_flag || !grm_flag || m_grm_flag || grm_sp_flag || bivar_reml_flag || mlma_flag || mlma_loco_flag) throw("Error: the option --reml-spectral only works with a univariate REML analysis (--reml) of a single GRM (--grm).");
+        if(!qgxe_file.empty() || !gxe_file.empty()) throw("Error: the option --reml-spectral can't be used in combination with --gxe or --gxqe.");
+        if(reml_mtd==1) throw("Error: the option --reml-spectral only works with the AI-REML (--reml-alg 0) or EM-REML (--reml-alg 2) algorithm.");
+    }
+    if(reml_precision>0){
+        if(!reml_flag || grm_sp_flag || bivar_reml_flag || mlma_flag || mlma_loco_flag || reml_spectral) throw("Error: the option --reml-precision only works with a univariate REML analysis (--reml) of dense GRMs (--grm or --mgrm).");
+        if(reml_mtd==1) throw("Error: the option --reml-precision only works with the AI-REML (--reml-alg 0) or EM-REML (--reml-alg 2) algorithm.");
+    }
     if(dosage_compen>-1 && update_sex_file.empty()) throw("Error: you need to specify the sex information for the individuals by the option --update-sex because of the option --dc.");
     if(bfile2_flag && update_freq_file.empty()) throw("Error: you need to update the allele frequency by the option --update-freq because there are two datasets.");
     if(mlma_flag || mlma_loco_flag){
@@ -851,6 +1035,11 @@ void option(int option_num, char* option_str[])
 	cout<<endl;
     gcta *pter_gcta=new gcta(autosome_num, out);//, *pter_gcta2=new gcta(autosome_num, rm_high_ld_cutoff, out);
 	if(grm_bin_flag || m_grm_bin_flag) pter_gcta->enable_grm_bin_flag();
+    if(make_grm_block>0) pter_gcta->enable_geno_stream(make_grm_block);
+    else if(pca_block>0) pter_gcta->enable_geno_stream(pca_block);
+    if(grm_part_num>0) pter_gcta->enable_grm_part(grm_part_num, grm_part);
+    if(grm_cbin_flag) pter_gcta->enable_grm_cbin_flag();
+    if(grm_cbin_out_flag) pter_gcta->enable_grm_cbin_output(grm_cbin_type>-1?grm_cbin_type:(int)GrmCbin::F32);
     //if(simu_unlinked_flag) pter_gcta->simu_geno_unlinked(simu_unlinked_n, simu_unlinked_m, simu_unlinked_maf);
     if(!RG_fname_file.empty()){
 		if(RG_summary_file.empty()) throw("Error: please input the summary information for the raw data files by the option --raw-summary.");
@@ -876,6 +1065,7 @@ void option(int option_num, char* option_str[])
 			if(!exclude_snp_name.empty()) pter_gcta->exclude_single_snp(exclude_snp_name);
 			if(!update_refA_file.empty()) pter_gcta->update_ref_A(update_refA_file);
 			if(LD) pter_gcta->read_LD_target_SNPs(LD_file);
+			if(!pc_load_file.empty()) pter_gcta->read_pc_loading(pc_load_file);
 			pter_gcta->read_bedfile(bfile+".bed");
 			if(!update_impRsq_file.empty()) pter_gcta->update_impRsq(update_impRsq_file);
 			if(!update_freq_file.empty()) pter_gcta->update_freq(update_freq_file);
@@ -885,7 +1075,11 @@ void option(int option_num, char* option_str[])
 			if(out_freq_flag) pter_gcta->save_freq(out_ssq_flag);
 			else if(!paa_file.empty()) pter_gcta->paa(paa_file);
 			else if(ibc) pter_gcta->ibc(ibc_all);
+            else if(make_grm_flag && make_grm_sp_flag) pter_gcta->make_grm_sparse(make_grm_xchar_flag, make_grm_inbred_flag, make_grm_mtd, make_grm_f3_flag, make_grm_sp_cutoff);
+            else if(make_grm_flag && (make_grm_chr_flag || !make_grm_maf_bin.empty() || !make_grm_snp_grp_file.empty())) pter_gcta->make_mgrm(make_grm_inbred_flag, grm_out_bin_flag, make_grm_mtd, make_grm_f3_flag, make_grm_chr_flag, make_grm_maf_bin, make_grm_snp_grp_file);
             else if(make_grm_flag) pter_gcta->make_grm_mkl(make_grm_xchar_flag, make_grm_inbred_flag, grm_out_bin_flag, make_grm_mtd, false, make_grm_f3_flag);
+            else if(pca_flag && !grm_flag && !m_grm_flag) pter_gcta->pca_geno(out_pc_num, pca_tol, pca_loading_flag);
+            else if(!pc_load_file.empty()) pter_gcta->project_pca();
 			else if(recode || recode_nomiss) pter_gcta->save_XMat(recode_nomiss);
 			else if(LD) pter_gcta->LD_Blocks(LD_step, LD_wind, LD_sig, LD_i, save_ram);
 			else if(blup_snp_flag) pter_gcta->blup_snp_geno();
@@ -926,16 +1120,21 @@ void option(int option_num, char* option_str[])
         else if(mlma_flag) pter_gcta->mlma(grm_file, phen_file, qcovar_file, covar_file, mphen, MaxIter, reml_priors, reml_priors_var, no_constrain, make_grm_inbred_flag, mlma_no_adj_covar);
         else if(mlma_loco_flag) pter_gcta->mlma_loco(phen_file, qcovar_file, covar_file, mphen, MaxIter, reml_priors, reml_priors_var, no_constrain, make_grm_inbred_flag, mlma_no_adj_covar);
 	}
+    else if(merge_grm_part_num>0) pter_gcta->merge_grm_part(merge_grm_part_file, merge_grm_part_num);
     else if(HE_reg_flag) pter_gcta->HE_reg(grm_file, phen_file, kp_indi_file, rm_indi_file, mphen);
 	else if((reml_flag || bivar_reml_flag) && phen_file.empty()) throw("\nError: phenotype file is required for reml analysis.\n");
     else if(bivar_reml_flag){
 		pter_gcta->fit_bivar_reml(grm_file, phen_file, qcovar_file, covar_file, kp_indi_file, rm_indi_file, update_sex_file, mphen, mphen2, grm_cutoff, grm_adj_fac, dosage_compen, m_grm_flag, pred_rand_eff, est_fix_eff, reml_mtd, MaxIter, reml_priors, reml_priors_var, reml_drop, no_lrt, prevalence, prevalence2, no_constrain, ignore_Ce, fixed_rg_val, bivar_no_constrain);
     }
+	else if(reml_flag && grm_sp_flag){
+		pter_gcta->fit_reml_sparse(grm_file, phen_file, qcovar_file, covar_file, kp_indi_file, rm_indi_file, mphen, m_grm_flag, pred_rand_eff, est_fix_eff, MaxIter, reml_priors, reml_priors_var, reml_drop, no_lrt, prevalence, no_constrain);
+	}
 	else if(reml_flag){
-		pter_gcta->fit_reml(grm_file, phen_file, qcovar_file, covar_file, qgxe_file, gxe_file, kp_indi_file, rm_indi_file, update_sex_file, mphen, grm_cutoff, grm_adj_fac, dosage_compen, m_grm_flag, pred_rand_eff, est_fix_eff, reml_mtd, MaxIter, reml_priors, reml_priors_var, reml_drop, no_lrt, prevalence, no_constrain, mlma_flag, within_family, reml_bending, reml_diag_one);
+		pter_gcta->fit_reml(grm_file, phen_file, qcovar_file, covar_file, qgxe_file, gxe_file, kp_indi_file, rm_indi_file, update_sex_file, mphen, grm_cutoff, grm_adj_fac, dosage_compen, m_grm_flag, pred_rand_eff, est_fix_eff, reml_mtd, MaxIter, reml_priors, reml_priors_var, reml_drop, no_lrt, prevalence, no_constrain, mlma_flag, within_family, reml_bending, reml_diag_one, reml_spectral, reml_precision);
 	}
 	else if(grm_flag || m_grm_flag){
-	    if(pca_flag) pter_gcta->pca(grm_file, kp_indi_file, rm_indi_file, grm_cutoff, m_grm_flag, out_pc_num);
+	    if(pca_flag) pter_gcta->pca(grm_file, kp_indi_file, rm_indi_file, grm_cutoff, m_grm_flag, out_pc_num, pca_approx_flag, pca_tol);
+	    else if(make_grm_eigen_flag) pter_gcta->save_grm_eigen(grm_file, kp_indi_file, rm_indi_file, grm_cutoff, m_grm_flag);
 	    else if(make_grm_flag) pter_gcta->save_grm(grm_file, kp_indi_file, rm_indi_file, update_sex_file, grm_cutoff, grm_adj_fac, dosage_compen, m_grm_flag, grm_out_bin_flag);
 	}
 	else throw("Error: no analysis has been launched by the option(s).\n");
@@ -45,13 +45,15 @@ void gcta::paa(string aa_file)
 	cout<<"Ancestral alleles for "<<icount<<" SNPs are included from ["+aa_file+"]."<<endl;
     
 	cout<<"Calculating proportion of ancestral alleles ..."<<endl;
+	int code=0;
 	double x=0.0;
 	vector<double> hom_aa_rare(_keep.size()), hom_aa_comm(_keep.size()), hom_da_rare(_keep.size()), hom_da_comm(_keep.size()), het_aa_rare(_keep.size()), het_aa_comm(_keep.size()), nomiss(_keep.size());
 	for(i=0; i<_keep.size(); i++){
  		for(k=0; k<_include.size(); k++){
  		    if(aa[_include[k]]==".") continue;
-            if(!_snp_1[_include[k]][_keep[i]] || _snp_2[_include[k]][_keep[i]]){
-                x=_snp_1[_include[k]][_keep[i]]+_snp_2[_include[k]][_keep[i]];
+            code=_geno.get(_include[k], _keep[i]);
+            if(!GenoStore::miss(code)){
+                x=GenoStore::dose(code);
                 if(x<0.1){
                     if(_ref_A[_include[k]]==aa[_include[k]]){
                         if(_mu[_include[k]]>1.0) hom_da_rare[i]+=1.0;
@@ -144,10 +146,12 @@ void gcta::ibc(bool ibc_all)
     }
     #pragma omp parallel for private(k)
     for(i=0; i<_keep.size(); i++){
+        int code=0;
         double x=0.0, sum_w=0.0, sum_h=0.0, Fhat_buf=0.0;
 		for(k=0; k<_include.size(); k++){
-            if(!_snp_1[_include[k]][_keep[i]] || _snp_2[_include[k]][_keep[i]]){
-                x=_snp_1[_include[k]][_keep[i]]+_snp_2[_include[k]][_keep[i]];
+            code=_geno.get(_include[k], _keep[i]);
+            if(!GenoStore::miss(code)){
+                x=GenoStore::dose(code);
                 if(_allele2[_include[k]]==_ref_A[_include[k]]) x=2.0-x;
                 Fhat_buf=(x-_mu[_include[k]])*(x-_mu[_include[k]]);
                 if(ibc_all) Fhat4[i]+=Fhat_buf;
@@ -54,12 +54,6 @@ void gcta::read_IRG_fnames(string snp_info_file, string fname_file, double GC_cu
     cout<<_indi_num<<" raw genotype data filenames specified in ["+fname_file+"]."<<endl;
 
     // read raw genotype file
-    _snp_1.resize(_snp_num);
-    _snp_2.resize(_snp_num);
-    for(i=0; i<_snp_num; i++){
-        _snp_1[i].reserve(_indi_num);
-        _snp_2[i].reserve(_indi_num);
-    }
     cout<<"Reading the raw genotype files and saving the genotype data in PLINK PED format ..."<<endl;
     cout<<"(SNP genotypes with GenCall rate < "<<GC_cutoff<<" are regarded as missing)"<<endl;
     string ped_file=_out+".ped";
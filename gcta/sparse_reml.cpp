@@ -0,0 +1,247 @@
+/*
+ * GCTA: a tool for Genome-wide Complex Trait Analysis
+ *
+ * Implementations of functions for REML analysis with sparse GRMs
+ *
+ * The GRMs and V are kept sparse. V is factorised by a sparse LDLT with a
+ * fill-reducing ordering, and Py, the AI matrix and the logL are calculated by
+ * solves with the factor rather than from V^-1 and P. tr(PA) only needs the
+ * elements of V^-1 on the non-zero pattern of A, which are calculated on the
+ * pattern of the factor by the Takahashi recurrences.
+ *
+ * This file is distributed under the GNU General Public
+ * License, Version 2.  Please see the file COPYING for more
+ * details
+ */
+
+#include "gcta.h"
+
+void gcta::fit_reml_sparse(string grm_file, string phen_file, string qcovar_file, string covar_file, string keep_indi_file, string remove_indi_file, int mphen, bool m_grm_flag, bool pred_rand_eff, bool est_fix_eff, int MaxIter, vector<double> reml_priors, vector<double> reml_priors_var, vector<int> drop, bool no_lrt, double prevalence, bool no_constrain)
+{
+    _reml_sparse=true;
+    _reml_mtd=0;
+    _reml_max_iter=MaxIter;
+    int i=0;
+    bool qcovar_flag=(!qcovar_file.empty());
+    bool covar_flag=(!covar_file.empty());
+
+    // Read data
+    int qcovar_num=0, covar_num=0;
+    vector<string> phen_ID, qcovar_ID, covar_ID, grm_id, grm_files;
+    vector< vector<string> > phen_buf, qcovar, covar;
+    if(m_grm_flag) read_grm_filenames(grm_file, grm_files, false);
+    else grm_files.push_back(grm_file);
+    for(i=0; i<grm_files.size(); i++){
+        read_grm_id(grm_files[i], grm_id, !m_grm_flag, true);
+        update_id_map_kp(grm_id, _id_map, _keep);
+    }
+    read_phen(phen_file, phen_ID, phen_buf, mphen);
+    update_id_map_kp(phen_ID, _id_map, _keep);
+    if(qcovar_flag){
+        qcovar_num=read_covar(qcovar_file, qcovar_ID, qcovar, true);
+        update_id_map_kp(qcovar_ID, _id_map, _keep);
+    }
+    if(covar_flag){
+        covar_num=read_covar(covar_file, covar_ID, covar, false);
+        update_id_map_kp(covar_ID, _id_map, _keep);
+    }
+    if(!keep_indi_file.empty()) keep_indi(keep_indi_file);
+    if(!remove_indi_file.empty()) remove_indi(remove_indi_file);
+
+    vector<string> uni_id;
+	map<string, int> uni_id_map;
+    map<string, int>::iterator iter;
+	for(i=0; i<_keep.size(); i++){
+	    uni_id.push_back(_fid[_keep[i]]+":"+_pid[_keep[i]]);
+	    uni_id_map.insert(pair<string,int>(_fid[_keep[i]]+":"+_pid[_keep[i]], i));
+	}
+    _n=_keep.size();
+    if(_n<1) throw("Error: no individual is in common in the input files.");
+
+    // construct model terms
+    _y.setZero(_n);
+    for(i=0; i<phen_ID.size(); i++){
+        iter=uni_id_map.find(phen_ID[i]);
+        if(iter==uni_id_map.end()) continue;
+        _y[iter->second]=atof(phen_buf[i][mphen-1].c_str());
+    }
+    _ncase=0.0;
+    _flag_CC=check_case_control(_ncase, _y);
+    cout<<endl;
+    if(_flag_CC && prevalence<-1) cout<<"Note: you can specify the disease prevalence by the option --prevalence so that GCTA can transform the variance explained to the underlying liability scale."<<endl;
+
+    _r_indx.clear();
+    for(i=0; i<grm_files.size()+1; i++) _r_indx.push_back(i);
+    if(!no_lrt) drop_comp(drop);
+    _Asp.resize(_r_indx.size());
+    if(m_grm_flag) cout<<"There are "<<grm_files.size()<<" GRM file names specified in the file ["+grm_file+"]."<<endl;
+    for(i=0; i<grm_files.size(); i++) read_grm_sparse(grm_files[i], uni_id, _Asp[i]);
+    (_Asp[grm_files.size()]).resize(_n, _n);
+    (_Asp[grm_files.size()]).reserve(VectorXi::Constant(_n, 1));
+    for(i=0; i<_n; i++) (_Asp[grm_files.size()]).insert(i,i)=1.0;
+    (_Asp[grm_files.size()]).makeCompressed();
+
+    // construct X matrix
+    vector<eigenMatrix> E_float;
+    eigenMatrix qE_float;
+    construct_X(_n, uni_id_map, qcovar_flag, qcovar_num, qcovar_ID, qcovar, covar_flag, covar_num, covar_ID, covar, E_float, qE_float);
+
+    // names of variance component
+    for(i=0; i<grm_files.size(); i++){
+        stringstream strstrm;
+        if(grm_files.size()==1) strstrm<<"";
+        else strstrm<<i+1;
+        _var_name.push_back("V(G"+strstrm.str()+")");
+        _hsq_name.push_back("V(G"+strstrm.str()+")/Vp");
+    }
+    _var_name.push_back("V(e)");
+
+    cout<<_n<<" individuals are in common in these files."<<endl;
+
+    // run REML algorithm
+	reml(pred_rand_eff, est_fix_eff, reml_priors, reml_priors_var, prevalence, -2.0, no_constrain, no_lrt);
+}
+
+void gcta::read_grm_sparse(string grm_file, const vector<string> &uni_id, eigenSparseMat &A)
+{
+    // elements of the lower triangle, one per line as in .grm.gz: row, column (1-based indices into the .grm.id file) and value
+    int i=0, j=0, n=0;
+    vector<string> grm_id;
+    vector<int> kp;
+    read_grm_id(grm_file, grm_id, false, true);
+    n=grm_id.size();
+    StrFunc::match(grm_id, uni_id, kp);
+
+    string sp_file=grm_file+".grm.sp.gz";
+    const int MAX_LINE_LENGTH = 1000;
+    char buf[MAX_LINE_LENGTH];
+    gzifstream i_sp;
+    i_sp.open(sp_file.c_str());
+    if(!i_sp.is_open()) throw("Error: can not open the file ["+sp_file+"] to read.");
+    cout<<"Reading the sparse GRM from ["+sp_file+"]."<<endl;
+    double g=0.0;
+    string errmsg="Error: failed to read ["+sp_file+"]. The format of the sparse GRM file has been changed?\nError occurs in line:\n";
+    vector< Triplet<eigenSparseMat::Scalar> > elem;
+    while(1){
+        i_sp.getline(buf, MAX_LINE_LENGTH, '\n');
+        if(i_sp.fail() || !i_sp.good()) break;
+        char *p=buf, *q=NULL;
+        i=strtol(p, &q, 10); if(q==p) throw(errmsg+buf); p=q;
+        j=strtol(p, &q, 10); if(q==p) throw(errmsg+buf); p=q;
+        g=strtod(p, &q); if(q==p) throw(errmsg+buf); p=q;
+        while(isspace(*p)) p++;
+        if(*p!='\0' || i<j || j<1 || i>n) throw(errmsg+buf);
+        i--;
+        j--;
+        if(kp[i]<0 || kp[j]<0) continue;
+        elem.push_back(Triplet<eigenSparseMat::Scalar>(kp[i], kp[j], g));
+        if(i!=j) elem.push_back(Triplet<eigenSparseMat::Scalar>(kp[j], kp[i], g));
+    }
+    i_sp.close();
+    A.resize(_n, _n);
+    A.setFromTriplets(elem.begin(), elem.end());
+    cout<<"Sparse GRM of "<<n<<" individuals read ("<<(A.nonZeros()-_n)/2<<" pairs of individuals in the analysis)."<<endl;
+}
+
+bool gcta::calcu_Vi_sparse(eigenVector &prev_varcmp, double &logdet)
+{
+    int i=0;
+    eigenSparseMat V=(_Asp[_r_indx[0]])*prev_varcmp[0];
+    for(i=1; i<_r_indx.size(); i++) V+=(_Asp[_r_indx[i]])*prev_varcmp[i];
+
+    // the ordering is recalculated because the non-zero pattern changes with the model
+    _V_sp_ldlt.compute(V);
+    if(_V_sp_ldlt.info()!=Success) throw("Error: the sparse LDLT decomposition of the variance-covariance matrix V failed.");
+    eigenVector d=_V_sp_ldlt.vectorD();
+    if(d.minCoeff()<=0.0) throw("Error: the variance-covariance matrix V is not positive definite.");
+    logdet=0.0;
+    for(i=0; i<_n; i++) logdet+=log(d[i]);
+    return true;
+}
+
+double gcta::calcu_P_sparse(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i)
+{
+    Vi_X=_V_sp_ldlt.solve(_X);
+	Xt_Vi_X_i=_X.transpose()*Vi_X;
+	return comput_inverse_logdet_LU(Xt_Vi_X_i, "\nError: the X^t * V^-1 * X matrix is not invertible. Please check the covariate(s).");
+}
+
+// Pv = V^-1 v - V^-1 X (X^t V^-1 X)^-1 X^t V^-1 v
+void gcta::calcu_Pv_sparse(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, const eigenMatrix &v, eigenMatrix &Pv)
+{
+    Pv=_V_sp_ldlt.solve(v);
+    Pv-=Vi_X*(Xt_Vi_X_i*(_X.transpose()*Pv));
+}
+
+// AI-REML (or EM-REML if em_flag) with the sparse V; Hi is the inverse of the AI matrix with AI-REML
+void gcta::ai_reml_sparse(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, eigenMatrix &Hi, eigenVector &Py, eigenVector &prev_varcmp, eigenVector &varcmp, double dlogL, bool em_flag)
+{
+    int i=0;
+    eigenMatrix mbuf, APy(_n, _r_indx.size()), PAPy;
+
+    calcu_Pv_sparse(Vi_X, Xt_Vi_X_i, _y, mbuf);
+    Py=mbuf.col(0);
+	for(i=0; i<_r_indx.size(); i++) (APy.col(i))=(_Asp[_r_indx[i]])*Py;
+    if(!em_flag) calcu_Pv_sparse(Vi_X, Xt_Vi_X_i, APy, PAPy);
+    eigenVector tr_PA;
+	calcu_tr_PA_sparse(Vi_X, Xt_Vi_X_i, tr_PA);
+    ai_reml_update(Py, APy, PAPy, tr_PA, Hi, prev_varcmp, varcmp, dlogL, em_flag);
+}
+
+// tr(PA) = tr(V^-1 A) - tr((X^t V^-1 X)^-1 X^t V^-1 A V^-1 X)
+void gcta::calcu_tr_PA_sparse(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, eigenVector &tr_PA)
+{
+    int i=0, j=0, k=0;
+
+    // elements of the inverse of the permuted V on the pattern of its factor L D L^t, computed from the last column
+    // backwards: Z(i,j)=-sum_k Z(i,k) L(k,j) and Z(j,j)=1/D(j)-sum_k L(k,j) Z(k,j) over the non-zeros k>j of column j.
+    // Z(i,k) is found in column min(i,k) because the pattern of L is closed under this recurrence
+    const eigenSparseMat &L=_V_sp_ldlt.matrixL().nestedExpression();
+    eigenVector d=_V_sp_ldlt.vectorD();
+    const int *Lp=L.outerIndexPtr(), *Li=L.innerIndexPtr();
+    const eigenSparseMat::Scalar *Lx=L.valuePtr();
+    vector<double> Zx(L.nonZeros()), Zd(_n);
+    for(j=_n-1; j>=0; j--){
+        int p=0, q=0, c_start=Lp[j], c_end=Lp[j+1];
+        for(p=c_start; p<c_end; p++){
+            double z=0.0;
+            i=Li[p];
+            for(q=c_start; q<c_end; q++){
+                k=Li[q];
+                if(k==i) z+=Zd[i]*Lx[q];
+                else{
+                    int c=min(i,k), r=max(i,k);
+                    const int *pos=lower_bound(Li+Lp[c], Li+Lp[c+1], r);
+                    if(pos==Li+Lp[c+1] || *pos!=r) throw("Error: the pattern of the sparse LDLT factor of V is not closed.");
+                    z+=Zx[pos-Li]*Lx[q];
+                }
+            }
+            Zx[p]=-z;
+        }
+        Zd[j]=1.0/d[j];
+        for(p=c_start; p<c_end; p++) Zd[j]-=Lx[p]*Zx[p];
+    }
+
+    // tr(V^-1 A) over the non-zeros of A, where V^-1(a,b)=Z(perm[a],perm[b])
+    const int *perm=_V_sp_ldlt.permutationP().indices().data();
+    eigenMatrix A_Vi_X;
+	tr_PA.resize(_r_indx.size());
+	for(i=0; i<_r_indx.size(); i++){
+        const eigenSparseMat &A=_Asp[_r_indx[i]];
+        double d_buf=0.0;
+        for(k=0; k<A.outerSize(); k++){
+            for(eigenSparseMat::InnerIterator it(A, k); it; ++it){
+                int r=perm[it.row()], c=perm[it.col()];
+                if(r==c) d_buf+=Zd[r]*it.value();
+                else{
+                    if(r<c) swap(r, c);
+                    const int *pos=lower_bound(Li+Lp[c], Li+Lp[c+1], r);
+                    if(pos==Li+Lp[c+1] || *pos!=r) throw("Error: the pattern of the sparse LDLT factor of V is not closed.");
+                    d_buf+=Zx[pos-Li]*it.value();
+                }
+            }
+        }
+        A_Vi_X=A*Vi_X;
+        tr_PA(i)=d_buf-(Xt_Vi_X_i*(Vi_X.transpose()*A_Vi_X)).trace();
+	}
+}
@@ -0,0 +1,113 @@
+/*
+ * GCTA: a tool for Genome-wide Complex Trait Analysis
+ *
+ * Implementations of functions for REML analysis by the eigendecomposition of the GRM
+ *
+ * With a single GRM A=UDU^t, V=U(s_g*D+s_e*I)U^t. After y and X are rotated
+ * by U^t once, V^-1, P and the products with the GRM are diagonal or of rank
+ * of X, so that each iteration takes O(n) for a fixed number of covariates.
+ * Py and V^-1 X are rotated back when the iterations have converged.
+ *
+ * This file is distributed under the GNU General Public
+ * License, Version 2.  Please see the file COPYING for more
+ * details
+ */
+
+#include "gcta.h"
+
+bool gcta::init_reml_spectral(string grm_file, const vector<string> &id, bool decomp_flag)
+{
+    // the eigendecomposition is read from the .grm.eigen file of the GRM if there is one matching the GRM in the analysis,
+    // otherwise it is calculated if decomp_flag
+    _spec_diag.resize(2);
+    string eigen_file=grm_file+".grm.eigen";
+    ifstream i_eigen(eigen_file.c_str());
+    bool eigen_flag=(!grm_file.empty() && i_eigen);
+    i_eigen.close();
+    if(!eigen_flag || !read_grm_eigen(grm_file, id, grm_digest(_A[0], id), _spec_diag[0], _spec_evec)){
+        if(!decomp_flag) return false;
+        cout<<"\nPerforming the eigendecomposition of the GRM ..."<<endl;
+        if(!eigen_sym_mkl(_A[0], _spec_diag[0])) throw("Error: the eigendecomposition of the GRM failed.");
+        _spec_evec.swap(_A[0]);
+    }
+    _reml_spectral=true;
+    _A[0].resize(0,0);
+    _A[_A.size()-1].resize(0,0);
+    _spec_diag[1]=eigenVector::Ones(_n);
+    if(_spec_diag[0].minCoeff()<0.0) cout<<"Note: the GRM is not positive semi-definite (smallest eigenvalue = "<<_spec_diag[0].minCoeff()<<")."<<endl;
+    _spec_y=_spec_evec.transpose()*_y;
+    _spec_X=_spec_evec.transpose()*_X;
+    return true;
+}
+
+// V^-1=UWU^t for the association tests after the REML; the eigenvectors are not needed afterwards
+void gcta::calcu_Vi_spectral(const vector<double> &varcmp)
+{
+    int i=0;
+    eigenVector w=eigenVector::Zero(_n);
+    for(i=0; i<_r_indx.size(); i++) w+=_spec_diag[_r_indx[i]]*varcmp[i];
+    w=w.cwiseInverse();
+    eigenMatrix U_W=_spec_evec*w.asDiagonal();
+    _Vi=U_W*_spec_evec.transpose();
+    _spec_evec.resize(0,0);
+}
+
+// Pv = W v - W X (X^t W X)^-1 X^t W v in the rotated space, W=V^-1 being diagonal
+void gcta::calcu_Pv_spectral(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, const eigenVector &w, const eigenMatrix &v, eigenMatrix &Pv)
+{
+    Pv=w.asDiagonal()*v;
+    Pv-=Vi_X*(Xt_Vi_X_i*(Vi_X.transpose()*v));
+}
+
+// AI-REML (or EM-REML if em_flag) in the rotated space, returning log|X^t V^-1 X|; Py and Vi_X are rotated,
+// and Hi is the inverse of the AI matrix with AI-REML
+double gcta::ai_reml_spectral(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, eigenMatrix &Hi, eigenVector &Py, eigenVector &prev_varcmp, eigenVector &varcmp, double &logdet, double dlogL, bool em_flag)
+{
+    int i=0;
+
+    // eigenvalues of V
+    eigenVector w=eigenVector::Zero(_n);
+    for(i=0; i<_r_indx.size(); i++) w+=_spec_diag[_r_indx[i]]*prev_varcmp[i];
+    if(w.minCoeff()<=0.0) throw("Error: the variance-covariance matrix V is not positive definite.");
+    logdet=0.0;
+    for(i=0; i<_n; i++) logdet+=log(w[i]);
+    w=w.cwiseInverse();
+
+    Vi_X=w.asDiagonal()*_spec_X;
+	Xt_Vi_X_i=_spec_X.transpose()*Vi_X;
+	double logdet_Xt_Vi_X=comput_inverse_logdet_LU(Xt_Vi_X_i, "\nError: the X^t * V^-1 * X matrix is not invertible. Please check the covariate(s).");
+    eigenMatrix mbuf, APy(_n, _r_indx.size()), PAPy;
+    calcu_Pv_spectral(Vi_X, Xt_Vi_X_i, w, _spec_y, mbuf);
+    Py=mbuf.col(0);
+	for(i=0; i<_r_indx.size(); i++) (APy.col(i))=_spec_diag[_r_indx[i]].cwiseProduct(Py);
+    if(!em_flag) calcu_Pv_spectral(Vi_X, Xt_Vi_X_i, w, APy, PAPy);
+
+	// Calcualte tr(PA) from the diagonal of P
+    eigenVector P_diag=w-((Vi_X*Xt_Vi_X_i).cwiseProduct(Vi_X)).rowwise().sum();
+    eigenVector tr_PA(_r_indx.size());
+    for(i=0; i<_r_indx.size(); i++) tr_PA(i)=P_diag.dot(_spec_diag[_r_indx[i]]);
+    ai_reml_update(Py, APy, PAPy, tr_PA, Hi, prev_varcmp, varcmp, dlogL, em_flag);
+
+    return logdet_Xt_Vi_X;
+}
+
+// inverse of the expected information matrix tr(PA_iPA_j) for the EM-REML, where P=W-M and M=W X (X^t W X)^-1 X^t W,
+// so that tr(PA_iPA_j) = sum(w^2 d_i d_j) - 2*sum(w d_i d_j diag(M)) + tr(G_i G_j) for G_i=(X^t W X)^-1 X^t W A_i W X
+void gcta::calcu_Hi_spectral(eigenMatrix &Vi_X, eigenMatrix &Xt_Vi_X_i, eigenVector &prev_varcmp, eigenMatrix &Hi)
+{
+    int i=0, j=0;
+    eigenVector w=eigenVector::Zero(_n);
+    for(i=0; i<_r_indx.size(); i++) w+=_spec_diag[_r_indx[i]]*prev_varcmp[i];
+    w=w.cwiseInverse();
+    eigenVector M_diag=((Vi_X*Xt_Vi_X_i).cwiseProduct(Vi_X)).rowwise().sum();
+    vector<eigenMatrix> G(_r_indx.size());
+    for(i=0; i<_r_indx.size(); i++) G[i]=Xt_Vi_X_i*(Vi_X.transpose()*(_spec_diag[_r_indx[i]].asDiagonal()*Vi_X));
+    for(i=0; i<_r_indx.size(); i++){
+        eigenVector d_i=_spec_diag[_r_indx[i]];
+        for(j=0; j<=i; j++){
+            eigenVector d_ij=d_i.cwiseProduct(_spec_diag[_r_indx[j]]);
+            Hi(i,j)=Hi(j,i)=(w.cwiseProduct(w)).dot(d_ij)-2.0*(w.cwiseProduct(M_diag)).dot(d_ij)+(G[i]*G[j]).trace();
+        }
+    }
+    if(!inverse_H(Hi)) throw("Error: the information matrix is not invertible.");
+}